@@ -1,12 +1,16 @@
 #include "./PIC12F1822_pic_programmer.h"
+#include "./PIC16F88X_pic_programmer.h"
 
-PIC12F1822_PicProgrammer::PIC12F1822_PicProgrammer(unsigned int flags) 
-	: PicProgrammer(flags)
+template<typename Traits>
+PIC12F1822_Family<Traits>::PIC12F1822_Family(unsigned int flags) 
+	: PicProgrammer(flags),
+	  targetAddress(-1L)
 { }
 
 // --------------- PIC PROGRAMMER IMPL ---------------- //
 
-bool PIC12F1822_PicProgrammer::enterProgrammingMode()
+template<typename Traits>
+bool PIC12F1822_Family<Traits>::enterProgrammingMode()
 {
 	// Handled externally
 	//
@@ -31,10 +35,10 @@ bool PIC12F1822_PicProgrammer::enterProgrammingMode()
 		digitalWrite(MCLR, LOW);
 	
 	// Wait for high voltage to charge
-	delayMicroseconds(1);
+	PicTiming::delayMicros(1);
 
 	digitalWrite(PVCC, HIGH);
-	delay(1);
+	PicTiming::delayMillis(1);
 
 	// If we're in low voltage programming
 	// mode we have to send sequence key.
@@ -44,7 +48,7 @@ bool PIC12F1822_PicProgrammer::enterProgrammingMode()
 		// Send 32-bit key-sequence + 1 extra
 		// clock pulse to enter programming mode.
 		PicSerial::writeBits(KEY_SEQ, 32 + 1);
-		delay(1);
+		PicTiming::delayMillis(1);
 	}
 
 	// We're now ready to program the device.
@@ -52,95 +56,137 @@ bool PIC12F1822_PicProgrammer::enterProgrammingMode()
 
 	// Address is loaded as zero
 	this->address = 0L;
+	this->targetAddress = 0L;
 	this->extendedAddress = 0;
 
 	return true;
 }
 
-void PIC12F1822_PicProgrammer::leaveProgrammingMode()
+template<typename Traits>
+void PIC12F1822_Family<Traits>::leaveProgrammingMode()
 {
-	// Set all serial pins low
-	digitalWrite(ICSPCLK, LOW);
-	digitalWrite(ICSPDAT, LOW);
-
-	// Set MCLR to a high impedance
-	// input.
-	pinMode(MCLR, INPUT);
-  
-	// Wait 1 millisecond for voltage
-	// to discharge from circuit.
-	delay(1);
-
-	// Turn off V+
-	digitalWrite(PVCC,    LOW);
-
-	this->programming = false;
+	this->powerOff();
 }
 
-void PIC12F1822_PicProgrammer::beginReading() 
+template<typename Traits>
+void PIC12F1822_Family<Traits>::beginReading() 
 {
 }
 
-int PIC12F1822_PicProgrammer::readProgramWord()
+template<typename Traits>
+int PIC12F1822_Family<Traits>::readProgramWord()
 {
-	int data = this->commandReadProgramMemory();
+	bool dataMemory = this->targetAddress >= Traits::DATA_ADDRESS;
+	this->seek();
+
+	int data;
+	if (dataMemory) {
+		data = this->commandReadDataMemory();
+	} else {
+		data = this->commandReadProgramMemory();
+	}
 	this->commandIncrementAddress();
+
+	this->targetAddress = this->address;
+	if (dataMemory)
+		this->targetAddress += Traits::DATA_ADDRESS;
 	return data;
 }
 
-void PIC12F1822_PicProgrammer::endReading() 
+template<typename Traits>
+void PIC12F1822_Family<Traits>::endReading() 
 {
 }
 
-void PIC12F1822_PicProgrammer::beginWriting()
+template<typename Traits>
+void PIC12F1822_Family<Traits>::beginWriting()
 {
 }
 
-void PIC12F1822_PicProgrammer::programWriteBuffer(unsigned char *const writeBuffer, unsigned int numBytes) 
+template<typename Traits>
+void PIC12F1822_Family<Traits>::programWriteBuffer(unsigned char *const writeBuffer, unsigned int numBytes) 
 {
+	if (this->targetAddress >= Traits::DATA_ADDRESS) {
+		this->programDataMemory(writeBuffer, numBytes);
+		return;
+	}
+
+	this->seek();
+
 	unsigned int data;
 	unsigned int offset = 0;
+	// Whether a latch of the current
+	// row has been loaded.
+	bool rowLoaded = false;
 	while (offset < numBytes) {
+		PicTiming::idle();
+
 		data = PicMemory::bytesToUnsignedInt(writeBuffer, offset, numBytes, false);
 		offset += 2;
 
-		this->commandLoadProgramMemory(data);
-		this->commandBeginInternalProgramming();
+		// Erased words are not loaded. The
+		// latches are left erased instead.
+		if ((data & ERASED_WORD) != ERASED_WORD) {
+			this->commandLoadProgramMemory(data);
+			rowLoaded = true;
+		} else {
+			PicProgrammer::skippedWords++;
+		}
+
+		if (this->address >= Traits::CONFIG_ADDRESS) {
+			// The configuration memory has no
+			// row of latches. Program it word
+			// by word.
+			if (rowLoaded)
+				this->commandBeginInternalProgramming();
+			rowLoaded = false;
+		} else if (offset >= numBytes || (this->address + 1) % Traits::ROW_SIZE == 0) {
+			// Program the row once its last latch
+			// is loaded or we run out of data. The
+			// latches are reset after programming,
+			// so latches not loaded are left erased.
+			// Fully erased rows are skipped.
+			if (rowLoaded) {
+				this->commandBeginExternalProgramming();
+				this->commandEndExternalProgramming();
+			}
+			rowLoaded = false;
+		}
+
 		this->commandIncrementAddress();
 	}
+
+	this->targetAddress = this->address;
 }
 
-void PIC12F1822_PicProgrammer::endWriting()
+template<typename Traits>
+void PIC12F1822_Family<Traits>::endWriting()
 {
 }
 
-void PIC12F1822_PicProgrammer::setExtendedAddress(unsigned int extAddr)
+template<typename Traits>
+void PIC12F1822_Family<Traits>::setExtendedAddress(unsigned int extAddr)
 {
 	this->extendedAddress = extAddr;
 	this->setAddress(0);
 }
 
-void PIC12F1822_PicProgrammer::setAddress(long long addr)
+template<typename Traits>
+void PIC12F1822_Family<Traits>::setAddress(pic_address_t addr)
 {
 	// Each address is two bytes. Therefore we have
 	// to divide byte-offset by two.
 	addr += (EXTENDED_ADDRESS_BYTE_OFFSET / 2) * this->extendedAddress;
 
-	// If it's possible to load config address, do so.
-	if (addr >= this->getConfigAddress() && this->address < this->getConfigAddress()) {
-		this->commandLoadConfiguration(-1);
-	} else if (addr < this->address || this->address == -1L) {
-		// We have to reset the address
-		this->commandResetAddress();
-	}
-
-	// Increment address until we're at the
-	// correct program-word.
-	while (this->address != addr)
-		this->commandIncrementAddress();
+	// The device address is only changed
+	// by the next read or write. Setting the
+	// extended address and then the address
+	// only results in a single seek.
+	this->targetAddress = addr;
 }
 
-int PIC12F1822_PicProgrammer::readDeviceId()
+template<typename Traits>
+int PIC12F1822_Family<Traits>::readDeviceId()
 {
 	// Load address 8000h
 	this->commandLoadConfiguration(-1);
@@ -162,35 +208,130 @@ int PIC12F1822_PicProgrammer::readDeviceId()
 	return dev_id >> 5;
 }
 
-void PIC12F1822_PicProgrammer::eraseDevice()
+template<typename Traits>
+void PIC12F1822_Family<Traits>::eraseDevice()
 {
 	this->commandLoadConfiguration(-1);
 	this->commandBulkEraseProgramMemory();
 }
 
+template<typename Traits>
+bool PIC12F1822_Family<Traits>::eraseRow()
+{
+	// Data memory has no rows
+	if (this->targetAddress >= Traits::DATA_ADDRESS)
+		return false;
+
+	this->seek();
+
+	// Only rows of program memory
+	// can be erased.
+	if (this->address >= Traits::CONFIG_ADDRESS)
+		return false;
+
+	// Erases the row of the address
+	this->commandRowEraseProgramMemory();
+	return true;
+}
+
+template<typename Traits>
+unsigned int PIC12F1822_Family<Traits>::getRowBytes() const
+{
+	// Words are sent as two bytes
+	return Traits::ROW_SIZE * 2;
+}
+
+// ---------------- SEEK HELPER FUNC ----------------- //
+
+template<typename Traits>
+void PIC12F1822_Family<Traits>::seek()
+{
+	// Data memory is addressed by the low
+	// bits of the program counter.
+	pic_address_t addr = this->targetAddress;
+	if (addr >= Traits::DATA_ADDRESS)
+		addr -= Traits::DATA_ADDRESS;
+
+	if (this->address == addr)
+		return;
+
+	pic_address_t configAddr = Traits::CONFIG_ADDRESS;
+
+	// The cost of each route is counted
+	// in clock pulses. Start with the route
+	// that is always possible: load config
+	// or reset address, then increment.
+	unsigned char route;
+	unsigned long cost;
+	if (addr >= configAddr) {
+		route = SEEK_LOAD_CONFIG;
+		cost = (CMD_ID_LEN + 16) + (addr - configAddr) * CMD_ID_LEN;
+	} else {
+		route = SEEK_RESET;
+		cost = Traits::RESET_ADDRESS_COST + addr * CMD_ID_LEN;
+	}
+
+	// We can only increment within the
+	// same memory space (if the address
+	// is known).
+	bool sameSpace = this->address != -1L && 
+		(this->address >= configAddr) == (addr >= configAddr);
+	if (sameSpace) {
+		unsigned long increments;
+		if (this->address < addr) {
+			increments = addr - this->address;
+		} else {
+			// The program counter wraps around
+			// at the end of the memory space.
+			increments = configAddr - this->address + addr;
+		}
+
+		if (increments * CMD_ID_LEN < cost)
+			route = SEEK_INCREMENT;
+	}
+
+	if (route == SEEK_LOAD_CONFIG) {
+		this->commandLoadConfiguration(-1);
+	} else if (route == SEEK_RESET) {
+		this->commandResetAddress();
+	}
+
+	// Increment address until we're at the
+	// correct program-word.
+	while (this->address != addr)
+		this->commandIncrementAddress();
+}
+
 // --------------- COMMAND HELPER FUNC ---------------- //
 
-void PIC12F1822_PicProgrammer::commandEntry(unsigned int id) const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandEntry(unsigned int id) const
 {
 	PicSerial::writeMode();
 	PicSerial::writeBits(id, CMD_ID_LEN);
+
+	// Delay between command and data
+	// or next command (TDLY).
+	PicTiming::delayMicros(1);
 }
 
 // --------------- LOAD CONFIG COMMAND ---------------- //
 
-void PIC12F1822_PicProgrammer::commandLoadConfiguration(unsigned int data)
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandLoadConfiguration(unsigned int data)
 {
 	this->commandEntry(LD_CON_CMD);
 	PicSerial::writeBit(0);
 	PicSerial::writeBits(data, 14);
 	PicSerial::writeBit(0);
 
-	this->address = this->getConfigAddress();
+	this->address = Traits::CONFIG_ADDRESS;
 }
 
 // ---------------- LOAD DATA COMMANDS ---------------- //
 
-void PIC12F1822_PicProgrammer::commandLoadProgramMemory(unsigned int data) const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandLoadProgramMemory(unsigned int data) const
 {
 	this->commandEntry(LD_PRO_CMD);
 	PicSerial::writeBit(0);
@@ -198,7 +339,8 @@ void PIC12F1822_PicProgrammer::commandLoadProgramMemory(unsigned int data) const
 	PicSerial::writeBit(0);
 }
 
-void PIC12F1822_PicProgrammer::commandLoadDataMemory(unsigned int data) const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandLoadDataMemory(unsigned int data) const
 {
 	this->commandEntry(LD_DAT_CMD);
 	PicSerial::writeBit(0);
@@ -208,7 +350,8 @@ void PIC12F1822_PicProgrammer::commandLoadDataMemory(unsigned int data) const
 
 // ---------------- READ DATA COMMANDS ---------------- //
 
-int PIC12F1822_PicProgrammer::commandReadProgramMemory() const
+template<typename Traits>
+int PIC12F1822_Family<Traits>::commandReadProgramMemory() const
 {
 	this->commandEntry(RD_PRO_CMD);
 
@@ -221,7 +364,8 @@ int PIC12F1822_PicProgrammer::commandReadProgramMemory() const
 	return data;
 }
 
-int PIC12F1822_PicProgrammer::commandReadDataMemory() const
+template<typename Traits>
+int PIC12F1822_Family<Traits>::commandReadDataMemory() const
 {
 	this->commandEntry(RD_DAT_CMD);
 
@@ -238,14 +382,25 @@ int PIC12F1822_PicProgrammer::commandReadDataMemory() const
 
 // ------------- PROGRAM COUNTER COMMANDS ------------- //
 
-void PIC12F1822_PicProgrammer::commandIncrementAddress()
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandIncrementAddress()
 {
 	this->commandEntry(INCR_A_CMD);
 
 	this->address++;
+
+	// The program counter wraps around at
+	// the end of program and config memory.
+	pic_address_t configAddr = Traits::CONFIG_ADDRESS;
+	if (this->address == configAddr) {
+		this->address = 0;
+	} else if (this->address == 2 * configAddr) {
+		this->address = configAddr;
+	}
 }
 
-void PIC12F1822_PicProgrammer::commandResetAddress()
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandResetAddress()
 {
 	this->commandEntry(REST_A_CMD);
 
@@ -254,51 +409,104 @@ void PIC12F1822_PicProgrammer::commandResetAddress()
 
 // --------------- PROGRAMMING COMMANDS --------------- //
 
-void PIC12F1822_PicProgrammer::commandBeginInternalProgramming() const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandBeginInternalProgramming() const
 {
 	this->commandEntry(BEG_IN_CMD);
-	if (this->address >= this->getConfigAddress()) {
-		delay(5);
+	if (this->address >= Traits::CONFIG_ADDRESS) {
+		PicTiming::delayMillis(Traits::CONFIG_PROGRAM_DELAY_MS);
 	} else {
-		delay(3);
+		PicTiming::delayMillis(Traits::PROGRAM_DELAY_MS);
 	}
 }
 
-void PIC12F1822_PicProgrammer::commandBeginExternalProgramming() const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandBeginExternalProgramming() const
 {
 	this->commandEntry(BEG_EX_CMD);
-	delay(1);
+	PicTiming::delayMillis(1);
 }
 
-void PIC12F1822_PicProgrammer::commandEndExternalProgramming() const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandEndExternalProgramming() const
 {
 	this->commandEntry(END_EX_CMD);
-	delayMicroseconds(100);
+	PicTiming::delayMicros(100);
 }
 
 // -------------- ERASE MEMORY COMMANDS --------------- //
 
-void PIC12F1822_PicProgrammer::commandBulkEraseProgramMemory() const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandBulkEraseProgramMemory() const
 {
 	this->commandEntry(ER_PRO_CMD);
-	delay(5);
+	PicTiming::delayMillis(Traits::BULK_ERASE_DELAY_MS);
 }
 
-void PIC12F1822_PicProgrammer::commandBulkEraseDataMemory() const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandBulkEraseDataMemory() const
 {
 	this->commandEntry(ER_DAT_CMD);
-	delay(5);
+	PicTiming::delayMillis(Traits::BULK_ERASE_DELAY_MS);
 }
 
-void PIC12F1822_PicProgrammer::commandRowEraseProgramMemory() const
+template<typename Traits>
+void PIC12F1822_Family<Traits>::commandRowEraseProgramMemory() const
 {
 	this->commandEntry(ER_ROW_CMD);
-	delay(3);
+	PicTiming::delayMillis(Traits::ROW_ERASE_DELAY_MS);
 }
 
 // ---------- PROGRAMMING HELPER FUNCTIONS ------------ //
 
-long long PIC12F1822_PicProgrammer::getConfigAddress() const 
+template<typename Traits>
+void PIC12F1822_Family<Traits>::programDataMemory(unsigned char *const writeBuffer, unsigned int numBytes)
 {
-	return PIC12F1822_CONFIG_ADDR;
+	this->seek();
+
+	unsigned int data;
+	unsigned int offset = 0;
+	while (offset < numBytes) {
+		// Each byte of data memory is sent
+		// as a word. The byte is erased and
+		// written by a single cycle, so even
+		// erased bytes (FFh) are written.
+		data = PicMemory::bytesToUnsignedInt(writeBuffer, offset, numBytes, false);
+		offset += 2;
+
+		this->commandLoadDataMemory(data & 0xFF);
+		this->commandEntry(BEG_IN_CMD);
+		PicTiming::delayMillis(Traits::DATA_PROGRAM_DELAY_MS);
+
+		this->commandIncrementAddress();
+	}
+
+	this->targetAddress = this->address + Traits::DATA_ADDRESS;
+}
+
+template<typename Traits>
+void PIC12F1822_Family<Traits>::powerOff()
+{
+	// Set all serial pins low
+	digitalWrite(ICSPCLK, LOW);
+	PicSerial::dataLow();
+
+	// Set MCLR to a high impedance
+	// input.
+	pinMode(MCLR, INPUT);
+  
+	// Wait 1 millisecond for voltage
+	// to discharge from circuit.
+	PicTiming::delayMillis(1);
+
+	// Turn off V+
+	digitalWrite(PVCC,    LOW);
+
+	this->programming = false;
 }
+
+// The specifications of the family. The
+// PIC16F88X specializations are located
+// in PIC16F88X_pic_programmer.cpp.
+template class PIC12F1822_Family<PIC12F1822_Traits>;
+template class PIC12F1822_Family<PIC16F88X_Traits>;
@@ -14,6 +14,18 @@
 // loaded when issuing a loadConfig command
 #define PIC12F1822_CONFIG_ADDR 0x8000
 
+// Address of the data memory (EEPROM) in
+// the hex file. The device addresses it by
+// the low bits of the program counter.
+#define PIC12F1822_DATA_ADDR 0xF000
+
+// Number of program memory write latches
+// used per programming cycle. Devices in
+// this specification have at least 8 (the
+// PIC12F1822 has 16). Using fewer latches
+// than available only costs extra cycles.
+#define PIC12F1822_ROW_SIZE 8
+
 // Key sequence for low voltage
 // programming mode.
 #define KEY_SEQ    0x4D434850
@@ -41,16 +53,59 @@
 #define BEG_EX_CMD 0x18
 #define END_EX_CMD 0x0A
 
+// Value (and mask) of an erased
+// program word.
+#define ERASED_WORD 0x3FFF
+
+// Routes to seek an address
+#define SEEK_INCREMENT   0
+#define SEEK_RESET       1
+#define SEEK_LOAD_CONFIG 2
+
 // Bulk erase commands
 #define ER_PRO_CMD 0x09
 #define ER_DAT_CMD 0x0B
 #define ER_ROW_CMD 0x11
 
-class PIC12F1822_PicProgrammer : public PicProgrammer
+// Memory layout and timing of the PIC12F1822
+// specification. Specifications in the same
+// family provide their own traits, which are
+// resolved at compile time.
+struct PIC12F1822_Traits
+{
+	static constexpr pic_address_t CONFIG_ADDRESS = PIC12F1822_CONFIG_ADDR;
+	static constexpr pic_address_t DATA_ADDRESS = PIC12F1822_DATA_ADDR;
+	static constexpr unsigned int ROW_SIZE = PIC12F1822_ROW_SIZE;
+	// Resetting the address is a single command
+	static constexpr unsigned long RESET_ADDRESS_COST = CMD_ID_LEN;
+
+	// Internally timed programming of program
+	// and configuration memory (TPINT).
+	static constexpr unsigned long PROGRAM_DELAY_MS = 3;
+	static constexpr unsigned long CONFIG_PROGRAM_DELAY_MS = 5;
+	// Internally timed erase and write of a
+	// byte of data memory (TDPINT).
+	static constexpr unsigned long DATA_PROGRAM_DELAY_MS = 5;
+	// Bulk erase (TERAB) and row erase (TERAR)
+	static constexpr unsigned long BULK_ERASE_DELAY_MS = 5;
+	static constexpr unsigned long ROW_ERASE_DELAY_MS = 3;
+};
+
+// Programmer of the PIC12F1822 family. Only the
+// PicProgrammer interface is virtual, the command
+// helpers are resolved by the traits at compile
+// time.
+template<typename Traits>
+class PIC12F1822_Family : public PicProgrammer
 {
 
 public:
-	PIC12F1822_PicProgrammer(unsigned int flags);
+	// The address set by setAddress. The
+	// device is moved to it by seek.
+	pic_address_t targetAddress;
+
+public:
+	PIC12F1822_Family(unsigned int flags);
 
 	// --------------- PIC PROGRAMMER IMPL ---------------- //
 	
@@ -70,50 +125,62 @@ public:
 
 	// Address related functions
 	virtual void setExtendedAddress(unsigned int extAddr);
-	virtual void setAddress(long long addr);
+	virtual void setAddress(pic_address_t addr);
 	
 	// Device related functions
 	virtual int readDeviceId();
 	virtual void eraseDevice();
+	virtual bool eraseRow();
+	virtual unsigned int getRowBytes() const;
 
 protected:
+	// ---------------- SEEK HELPER FUNC ----------------- //
+
+	void seek();
+
 	// --------------- COMMAND HELPER FUNC ---------------- //
 
-	virtual void commandEntry(unsigned int id) const;
+	void commandEntry(unsigned int id) const;
 
 	// --------------- LOAD CONFIG COMMAND ---------------- //
 
-	virtual void commandLoadConfiguration(unsigned int data);
+	void commandLoadConfiguration(unsigned int data);
 
 	// ---------------- LOAD DATA COMMANDS ---------------- //
 
-	virtual void commandLoadProgramMemory(unsigned int data) const;
-	virtual void commandLoadDataMemory(unsigned int data) const;
+	void commandLoadProgramMemory(unsigned int data) const;
+	void commandLoadDataMemory(unsigned int data) const;
 
 	// ---------------- READ DATA COMMANDS ---------------- //
 
-	virtual int commandReadProgramMemory() const;
-	virtual int commandReadDataMemory() const;
+	int commandReadProgramMemory() const;
+	int commandReadDataMemory() const;
 
 	// ------------- PROGRAM COUNTER COMMANDS ------------- //
 
-	virtual void commandIncrementAddress();
-	virtual void commandResetAddress();
+	void commandIncrementAddress();
+	void commandResetAddress();
 
 	// --------------- PROGRAMMING COMMANDS --------------- //
 
-	virtual void commandBeginInternalProgramming() const;
-	virtual void commandBeginExternalProgramming() const;
-	virtual void commandEndExternalProgramming() const;
+	void commandBeginInternalProgramming() const;
+	void commandBeginExternalProgramming() const;
+	void commandEndExternalProgramming() const;
 
 	// -------------- ERASE MEMORY COMMANDS --------------- //
 
-	virtual void commandBulkEraseProgramMemory() const;
-	virtual void commandBulkEraseDataMemory() const;
-	virtual void commandRowEraseProgramMemory() const;
+	void commandBulkEraseProgramMemory() const;
+	void commandBulkEraseDataMemory() const;
+	void commandRowEraseProgramMemory() const;
 
 	// ---------- PROGRAMMING HELPER FUNCTIONS ------------ //
 
-	virtual long long getConfigAddress() const;
+	void programDataMemory(unsigned char *const writeBuffer, unsigned int numBytes);
+	void powerOff();
 
 };
+
+typedef PIC12F1822_Family<PIC12F1822_Traits> PIC12F1822_PicProgrammer;
+
+// Instantiated in PIC12F1822_pic_programmer.cpp
+extern template class PIC12F1822_Family<PIC12F1822_Traits>;
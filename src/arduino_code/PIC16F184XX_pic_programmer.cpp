@@ -14,16 +14,16 @@ bool PIC16F184XX_PicProgrammer::enterProgrammingMode()
 	digitalWrite(MCLR, HIGH);
 	if (lowVoltageMode)
 		digitalWrite(MCLR, LOW);
-	delayMicroseconds(1);
+	PicTiming::delayMicros(1);
 
 	digitalWrite(PVCC, HIGH);
-	delay(1);
+	PicTiming::delayMillis(1);
 
 	if (lowVoltageMode) {
 		PicSerial::writeMode();
 		
 		PicSerial::writeBitsMSBF(PIC16_KEY_SEQ, 32);
-		delay(1);
+		PicTiming::delayMillis(1);
 	}
 
 	this->programming = true;
@@ -40,11 +40,11 @@ void PIC16F184XX_PicProgrammer::leaveProgrammingMode()
 	// information on leaving programming mode.
 
 	digitalWrite(ICSPCLK, LOW);
-	digitalWrite(ICSPDAT, LOW);
+	PicSerial::dataLow();
 
 	pinMode(MCLR, INPUT);
   
-	delay(1);
+	PicTiming::delayMillis(1);
 
 	digitalWrite(PVCC,    LOW);
 
@@ -73,11 +73,56 @@ void PIC16F184XX_PicProgrammer::programWriteBuffer(unsigned char *const writeBuf
 {
 	unsigned int data;
 	unsigned int offset = 0;
+	// Whether a latch of the current
+	// row has been loaded.
+	bool rowLoaded = false;
 	while (offset < numBytes) {
+		PicTiming::idle();
+
 		data = PicMemory::bytesToUnsignedInt(writeBuffer, offset, numBytes, false);
 		offset += 2;
 
-		this->commandLoadProgramData(data);
+		// Erased words are not loaded. The
+		// latches are left erased instead.
+		bool erased = (data & PIC16_ERASED_WORD) == PIC16_ERASED_WORD;
+
+		// The write latches of a row are loaded
+		// one after the other and programmed by
+		// a single cycle, once the last latch is
+		// loaded or we run out of data. The
+		// config space (and data memory above
+		// it) is programmed word by word.
+		bool configSpace = this->address >= PIC16F184XX_CONFIG_ADDR;
+		// Bytes of data memory are sent as
+		// words, and always written.
+		if (this->address >= PIC16F184XX_DATA_ADDR)
+			erased = false;
+		if (erased)
+			PicProgrammer::skippedWords++;
+		if (!configSpace && offset < numBytes && (this->address + 1) % PIC16F184XX_ROW_SIZE != 0) {
+			if (erased) {
+				this->commandEntry(PIC16_INC_ADDR);
+				this->address++;
+			} else {
+				this->commandLoadProgramDataIncrement(data);
+				rowLoaded = true;
+			}
+			continue;
+		}
+
+		if (!erased) {
+			this->commandLoadProgramData(data);
+			rowLoaded = true;
+		}
+
+		// Skip programming of fully erased rows
+		if (!rowLoaded) {
+			this->commandEntry(PIC16_INC_ADDR);
+			this->address++;
+			continue;
+		}
+		rowLoaded = false;
+
 		this->commandEntry(PIC16_BEG_INT_PRO);
 
 		// Refer to datasheet: 2.5 Electrical Specifications
@@ -85,10 +130,10 @@ void PIC16F184XX_PicProgrammer::programWriteBuffer(unsigned char *const writeBuf
 		// Programming Operation Time) delay is 2.8ms when
 		// in program memory space and 5.6ms when in config
 		// space (rounded up to 3ms and 6ms).
-		if (this->address >= PIC16F184XX_CONFIG_ADDR) {
-			delay(6);
+		if (configSpace) {
+			PicTiming::delayMillis(6);
 		} else {
-			delay(3);
+			PicTiming::delayMillis(3);
 		}
 
 		this->commandEntry(PIC16_INC_ADDR);
@@ -106,7 +151,7 @@ void PIC16F184XX_PicProgrammer::setExtendedAddress(unsigned int extAddr)
 	this->setAddress(0);
 }
 
-void PIC16F184XX_PicProgrammer::setAddress(long long addr)
+void PIC16F184XX_PicProgrammer::setAddress(pic_address_t addr)
 {
 	// Each address is two bytes. Therefore we have
 	// to divide byte-offset by two.
@@ -133,13 +178,42 @@ int PIC16F184XX_PicProgrammer::readDeviceId()
 
 void PIC16F184XX_PicProgrammer::eraseDevice()
 {
+	// The memory erased depends on the pc
+	// address. From configuration memory,
+	// program and configuration memory are
+	// erased, not only the current region.
+	this->commandLoadPCAddress(PIC16F184XX_CONFIG_ADDR);
+
 	// Issue bulk erase function
 	this->commandEntry(PIC16_BULK_ERASE);
 
 	// Refer to datasheet: 2.5 Electrical Specifications
 	// Table 2-3. Under row TERAB (Bulk Erase Cycle Time)
 	// delay is 8.4ms (rounded up to 9ms)
-	delay(9);
+	PicTiming::delayMillis(9);
+}
+
+bool PIC16F184XX_PicProgrammer::eraseRow()
+{
+	// Only rows of program memory
+	// can be erased.
+	if (this->address >= PIC16F184XX_CONFIG_ADDR)
+		return false;
+
+	// Erases the row of the pc address
+	this->commandEntry(PIC16_ROW_ERASE);
+
+	// Refer to datasheet: 2.5 Electrical Specifications
+	// Table 2-3. Under row TERAR (Row Erase Cycle Time)
+	// delay is 2.8ms (rounded up to 3ms)
+	PicTiming::delayMillis(3);
+	return true;
+}
+
+unsigned int PIC16F184XX_PicProgrammer::getRowBytes() const
+{
+	// Words are sent as two bytes
+	return PIC16F184XX_ROW_SIZE * 2;
 }
 
 // --------------- COMMAND HELPER FUNC ---------------- //	
@@ -152,6 +226,10 @@ void PIC16F184XX_PicProgrammer::commandEntry(unsigned int id) const
 	// bit first. Hence we use the MSBF 
 	// functions.
 	PicSerial::writeBitsMSBF(id, PIC16_CMD_ID_LEN);
+
+	// Delay between command and data
+	// or next command (TDLY).
+	PicTiming::delayMicros(1);
 }
 
 // ----------------- READ DATA COMMAND ---------------- //
@@ -185,6 +263,19 @@ void PIC16F184XX_PicProgrammer::commandLoadProgramData(unsigned int data)
 	PicSerial::writeBit(0);
 }
 
+void PIC16F184XX_PicProgrammer::commandLoadProgramDataIncrement(unsigned int data) 
+{
+	this->commandEntry(PIC16_LD_DAT_INC);
+
+	// Write 24-bit payload
+	PicSerial::writeBitsMSBF(0x00, 9);
+	PicSerial::writeBitsMSBF(data, 14);
+	PicSerial::writeBit(0);
+
+	// This command is incrementing the pc
+	this->address++;
+}
+
 // --------------- LOAD ADDRESS COMMAND --------------- //
 
 void PIC16F184XX_PicProgrammer::commandLoadPCAddress(unsigned int addr) 
@@ -16,8 +16,16 @@
 
 // Device config space address
 #define PIC16F184XX_CONFIG_ADDR 0x8000
+// Address of the data memory (EEPROM). It
+// is read and written like configuration
+// memory, a word (byte) at a time.
+#define PIC16F184XX_DATA_ADDR 0xF000
 // Device id address
 #define PIC16F184XX_DEV_ID_ADDR 0x8006
+// Value (and mask) of an erased word
+#define PIC16_ERASED_WORD 0x3FFF
+// Number of program memory write latches
+#define PIC16F184XX_ROW_SIZE 32
 
 // Length / size of command ids in bits
 #define PIC16_CMD_ID_LEN 8
@@ -26,6 +34,8 @@
 #define PIC16_RD_DAT_INC 0xFE
 // Load data command
 #define PIC16_LD_DAT 0x00
+// Load data, post increment command
+#define PIC16_LD_DAT_INC 0x02
 
 // Load program counter address command
 #define PIC16_LD_PC_ADDR 0x80
@@ -36,6 +46,8 @@
 #define PIC16_BEG_INT_PRO 0xE0
 // Bulk erase device command
 #define PIC16_BULK_ERASE 0x18
+// Row erase program memory command
+#define PIC16_ROW_ERASE 0xF0
 
 class PIC16F184XX_PicProgrammer : public PicProgrammer 
 {
@@ -61,11 +73,13 @@ public:
 
 	// Address related functions
 	virtual void setExtendedAddress(unsigned int extAddr);
-	virtual void setAddress(long long addr);
+	virtual void setAddress(pic_address_t addr);
 	
 	// Device related functions
 	virtual int readDeviceId();
 	virtual void eraseDevice();
+	virtual bool eraseRow();
+	virtual unsigned int getRowBytes() const;
 
 private:
 	// --------------- COMMAND HELPER FUNC ---------------- //
@@ -79,6 +93,7 @@ private:
 	// ----------------- LOAD DATA COMMAND ---------------- //
 
 	void commandLoadProgramData(unsigned int data);
+	void commandLoadProgramDataIncrement(unsigned int data);
 
 	// --------------- LOAD ADDRESS COMMAND --------------- //
 
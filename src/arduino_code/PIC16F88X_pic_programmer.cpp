@@ -1,9 +1,6 @@
 #include "./PIC16F88X_pic_programmer.h"
 
-PIC16F88X_PicProgrammer::PIC16F88X_PicProgrammer(unsigned int flags) 
-	: PIC12F1822_PicProgrammer(flags)
-{ }
-
+template<>
 bool PIC16F88X_PicProgrammer::enterProgrammingMode() 
 {
 	// If we're already programming,
@@ -14,7 +11,7 @@ bool PIC16F88X_PicProgrammer::enterProgrammingMode()
 	// Set PGM high, if in low voltage mode
 	if (lowVoltageMode) {
 		digitalWrite(PGM, HIGH);
-		delayMicroseconds(2);
+		PicTiming::delayMicros(2);
 	}
 
 	// Set MCLR as output.
@@ -31,21 +28,23 @@ bool PIC16F88X_PicProgrammer::enterProgrammingMode()
 		// one kilo-ohm pull-down resistor.
 		digitalWrite(MCLR, HIGH);
 	}
-	delayMicroseconds(1);
+	PicTiming::delayMicros(1);
 
 	digitalWrite(PVCC, HIGH);
-	delay(1);
+	PicTiming::delayMillis(1);
 
 	// We're now ready to program the device.
 	this->programming = true;
 
 	// Reset address to zero
 	this->address = 0L;
+	this->targetAddress = 0L;
 	this->extendedAddress = 0;
 
 	return true;
 }
 
+template<>
 void PIC16F88X_PicProgrammer::leaveProgrammingMode()
 {
 	// We have to set the PGM pin
@@ -54,7 +53,7 @@ void PIC16F88X_PicProgrammer::leaveProgrammingMode()
 		digitalWrite(PGM, LOW);
 		// Wait for device to leave 
 		// programming mode.
-		delayMicroseconds(1);
+		PicTiming::delayMicros(1);
 
 		// If chip is in low voltage
 		// programming mode, the MCLR
@@ -70,9 +69,10 @@ void PIC16F88X_PicProgrammer::leaveProgrammingMode()
 
 	// We can use the same implementation
 	// as the PIC12F1822.
-	PIC12F1822_PicProgrammer::leaveProgrammingMode();
+	this->powerOff();
 }
 
+template<>
 void PIC16F88X_PicProgrammer::commandResetAddress() 
 {
 	// The PIC16F88X specification does not
@@ -80,57 +80,15 @@ void PIC16F88X_PicProgrammer::commandResetAddress()
 	// the address we have to re-enter the 
 	// programming mode instead.
 	if (this->programming) {
+		// Keep the addresses set by the
+		// transmitter.
+		pic_address_t targetAddr = this->targetAddress;
+		unsigned int extAddr = this->extendedAddress;
+
 		this->leaveProgrammingMode();
 		this->enterProgrammingMode();
-	}
-}
-
-// --------------- PROGRAMMING COMMANDS --------------- //
 
-void PIC16F88X_PicProgrammer::commandBeginInternalProgramming() const
-{
-	this->commandEntry(BEG_IN_CMD);
-	// The PIC16F88X specification only
-	// takes 3 ms to program it's program-
-	// memory. This is probably because
-	// the configuration addresses are in
-	// the low 2000h and not in the extended
-	// range.
-	delay(3);
-}
-
-// -------------- ERASE MEMORY COMMANDS --------------- //
-
-void PIC16F88X_PicProgrammer::commandBulkEraseProgramMemory() const
-{
-	// All erase commands in the
-	// PIC16F88X programming specification
-	// take 6 ms (TERA) to complete.
-	this->commandEntry(ER_PRO_CMD);
-	delay(6);
-}
-
-void PIC16F88X_PicProgrammer::commandBulkEraseDataMemory() const
-{
-	// All erase commands in the
-	// PIC16F88X programming specification
-	// take 6 ms (TERA) to complete.
-	this->commandEntry(ER_DAT_CMD);
-	delay(6);
-}
-
-void PIC16F88X_PicProgrammer::commandRowEraseProgramMemory() const
-{
-	// All erase commands in the
-	// PIC16F88X programming specification
-	// take 6 ms (TERA) to complete.
-	this->commandEntry(ER_ROW_CMD);
-	delay(6);
-}
-
-// ---------- PROGRAMMING HELPER FUNCTIONS ------------ //
-
-long long PIC16F88X_PicProgrammer::getConfigAddress() const
-{
-	return PIC16F88X_CONFIG_ADDR;
+		this->targetAddress = targetAddr;
+		this->extendedAddress = extAddr;
+	}
 }
@@ -15,41 +15,57 @@
 #include "./PIC12F1822_pic_programmer.h"
 
 #define PIC16F88X_CONFIG_ADDR 0x2000
+#define PIC16F88X_DATA_ADDR   0x2100
 
-class PIC16F88X_PicProgrammer : public PIC12F1822_PicProgrammer 
-{
-
-public:
-	PIC16F88X_PicProgrammer(unsigned int flags);
-
-	// --------------- PIC PROGRAMMER IMPL ---------------- //
-
-	// MCLR is on rising edge + handle PGM
-	virtual bool enterProgrammingMode();
-	// Handle PGM pin
-	virtual void leaveProgrammingMode();
-	
-protected:
-	// ------------- PROGRAM COUNTER COMMANDS ------------- //
-
-	// Re-implement the reset address function
-	virtual void commandResetAddress();
-	
-	// --------------- PROGRAMMING COMMANDS --------------- //
+// Program memory is written four
+// words at a time.
+#define PIC16F88X_ROW_SIZE 4
 
-	// Change the delay of the internal programming
-	virtual void commandBeginInternalProgramming() const;
+// Resetting the address means re-entering
+// programming mode, which takes about 2 ms.
+// That is worth roughly a thousand clock
+// pulses of increment commands.
+#define PIC16F88X_RESET_ADDR_COST 1000
 
-	// -------------- ERASE MEMORY COMMANDS --------------- //
+// The PIC16F88X only differs from the PIC12F1822
+// in its memory layout, its timing and the way
+// programming mode is entered and left.
+struct PIC16F88X_Traits
+{
+	// The config address is located at 2000h instead of 8000h
+	static constexpr pic_address_t CONFIG_ADDRESS = PIC16F88X_CONFIG_ADDR;
+	// Data memory is located at 2100h instead of F000h
+	static constexpr pic_address_t DATA_ADDRESS = PIC16F88X_DATA_ADDR;
+	// Only four write latches are available
+	static constexpr unsigned int ROW_SIZE = PIC16F88X_ROW_SIZE;
+	// Resetting the address is expensive
+	static constexpr unsigned long RESET_ADDRESS_COST = PIC16F88X_RESET_ADDR_COST;
 
-	// Erase cycles take 6 ms instead of 5 and 3
-	virtual void commandBulkEraseProgramMemory() const;
-	virtual void commandBulkEraseDataMemory() const;
-	virtual void commandRowEraseProgramMemory() const;
+	// The PIC16F88X specification only
+	// takes 3 ms to program both program
+	// and configuration memory. This is
+	// probably because the configuration
+	// addresses are in the low 2000h and
+	// not in the extended range.
+	static constexpr unsigned long PROGRAM_DELAY_MS = 3;
+	static constexpr unsigned long CONFIG_PROGRAM_DELAY_MS = 3;
+	// Erase and write of data memory (TDPROG)
+	static constexpr unsigned long DATA_PROGRAM_DELAY_MS = 6;
+	// All erase commands in the PIC16F88X
+	// programming specification take 6 ms
+	// (TERA) to complete.
+	static constexpr unsigned long BULK_ERASE_DELAY_MS = 6;
+	static constexpr unsigned long ROW_ERASE_DELAY_MS = 6;
+};
 
-	// ---------- PROGRAMMING HELPER FUNCTIONS ------------ //
+// MCLR is on rising edge + handle PGM
+template<> bool PIC12F1822_Family<PIC16F88X_Traits>::enterProgrammingMode();
+// Handle PGM pin
+template<> void PIC12F1822_Family<PIC16F88X_Traits>::leaveProgrammingMode();
+// Re-implement the reset address function
+template<> void PIC12F1822_Family<PIC16F88X_Traits>::commandResetAddress();
 
-	// The config address is located at 2000h instead of 8000h
-	virtual long long getConfigAddress() const;
+typedef PIC12F1822_Family<PIC16F88X_Traits> PIC16F88X_PicProgrammer;
 
-};
+// Instantiated in PIC12F1822_pic_programmer.cpp
+extern template class PIC12F1822_Family<PIC16F88X_Traits>;
@@ -1,7 +1,8 @@
 #include "./PIC18F1XK22_pic_programmer.h"
 
 PIC18F1XK22_PicProgrammer::PIC18F1XK22_PicProgrammer(unsigned int flags) 
-	: PicProgrammer(flags)
+	: PicProgrammer(flags),
+	  writing(false)
 { }
 
 bool PIC18F1XK22_PicProgrammer::enterProgrammingMode()
@@ -16,7 +17,7 @@ bool PIC18F1XK22_PicProgrammer::enterProgrammingMode()
 	// Set PGM high, if in low voltage mode
 	if (lowVoltageMode) {
 		digitalWrite(PGM, HIGH);
-		delayMicroseconds(2);
+		PicTiming::delayMicros(2);
 	}
 
 	// Set MCLR as output.
@@ -34,14 +35,17 @@ bool PIC18F1XK22_PicProgrammer::enterProgrammingMode()
 	// one kilo-ohm pull-down resistor.
 	digitalWrite(MCLR, HIGH);
 
-	delayMicroseconds(1);
+	PicTiming::delayMicros(1);
 
 	digitalWrite(PVCC, HIGH);
-	delay(1);
+	PicTiming::delayMillis(1);
 
 	// We're now ready to program the device.
 	this->programming = true;
 
+	// The table pointer is unknown
+	this->address = -1L;
+
 	return true;
 }
 
@@ -49,7 +53,7 @@ void PIC18F1XK22_PicProgrammer::leaveProgrammingMode()
 {
 	// Set all serial pins low
 	digitalWrite(ICSPCLK, LOW);
-	digitalWrite(ICSPDAT, LOW);
+	PicSerial::dataLow();
 
 	// Set MCLR to a high impedance
 	// input.
@@ -60,7 +64,7 @@ void PIC18F1XK22_PicProgrammer::leaveProgrammingMode()
   
 	// Wait 1 millisecond for voltage
 	// to discharge from circuit.
-	delay(1);
+	PicTiming::delayMillis(1);
 	
 	// Turn off V+
 	digitalWrite(PVCC,    LOW);
@@ -74,6 +78,9 @@ void PIC18F1XK22_PicProgrammer::beginReading()
 
 int PIC18F1XK22_PicProgrammer::readProgramWord()
 {
+	if (this->address >= PIC18F1XK22_DATA_ADDR)
+		return this->readDataMemory();
+
 	// Address will be incremented when
 	// reading.
 	this->address++;
@@ -100,9 +107,19 @@ void PIC18F1XK22_PicProgrammer::beginWriting()
 
 void PIC18F1XK22_PicProgrammer::programWriteBuffer(unsigned char *const writeBuffer, unsigned int numBytes)
 {
+	if (this->address >= PIC18F1XK22_DATA_ADDR) {
+		this->programDataMemory(writeBuffer, numBytes);
+		return;
+	}
+
 	unsigned int data;
 	unsigned int offset = 0;
+	// Whether the holding registers of the
+	// current block contain any data.
+	bool blockLoaded = false;
 	while (offset < numBytes) {
+		PicTiming::idle();
+
 		bool configSpace = this->address >= this->getConfigAddress();
 		if (configSpace) {
 			// Write a single byte at a time.
@@ -111,10 +128,32 @@ void PIC18F1XK22_PicProgrammer::programWriteBuffer(unsigned char *const writeBuf
 			this->instructionTableWriteStartProg((data << 8) | data);
 			offset++;
 		} else {
-			// Program two bytes at a time, little endian
+			// Load two bytes at a time, little endian
 			data = PicMemory::bytesToUnsignedInt(writeBuffer, offset, numBytes, false);
-			this->instructionTableWriteStartProg(data);
 			offset += 2;
+
+			// Erased bytes (FFh) leave the
+			// holding registers unchanged.
+			if (data != 0xFFFF) {
+				blockLoaded = true;
+			} else {
+				PicProgrammer::skippedWords++;
+			}
+
+			// Fill the holding registers of the
+			// block, post-incrementing the table
+			// pointer. The last two bytes of the
+			// block (or data) start programming,
+			// unless the block is fully erased.
+			bool blockEnd = offset >= numBytes || (this->address + 2) % PIC18F1XK22_WRITE_BLOCK_SIZE == 0;
+			if (!blockEnd || !blockLoaded) {
+				this->instructionTableWritePostInc(data);
+				this->address += 2;
+				continue;
+			}
+			blockLoaded = false;
+
+			this->instructionTableWriteStartProg(data);
 		}
 		
 		// Refer to: 4.2 Flash Programming
@@ -128,19 +167,19 @@ void PIC18F1XK22_PicProgrammer::programWriteBuffer(unsigned char *const writeBuf
 	
 		// Do last clock-pulse (hold 4th pulse 
 		// high for time P9 and low for time P10).
-		digitalWrite(ICSPDAT, LOW);
-		digitalWrite(ICSPCLK, HIGH);
+		PicSerial::dataLow();
+		PicSerial::clockHigh();
 		// If we're in program-flash-space, 
 		// we should sleep P9 or 1ms. If we're 
 		// in config-space we should sleep P9A
 		// or 5ms.
 		if (configSpace) {
-			delay(5);
+			PicTiming::delayMillis(5);
 		} else {
-			delay(1);
+			PicTiming::delayMillis(1);
 		}
-		digitalWrite(ICSPCLK, LOW);
-		delayMicroseconds(100);
+		PicSerial::clockLow();
+		PicTiming::delayMicros(100);
 
 		// Finish NOP command with 16-bit 
 		// operand. Refer to: Figure 4-5.
@@ -172,7 +211,7 @@ void PIC18F1XK22_PicProgrammer::setExtendedAddress(unsigned int extAddr)
 	this->setAddress(0);
 }
 
-void PIC18F1XK22_PicProgrammer::setAddress(long long addr)
+void PIC18F1XK22_PicProgrammer::setAddress(pic_address_t addr)
 {
 	// Add extended address to addr
 	addr += EXTENDED_ADDRESS_BYTE_OFFSET * this->extendedAddress;
@@ -185,7 +224,13 @@ void PIC18F1XK22_PicProgrammer::setAddress(long long addr)
 		if (this->writing) 
 			this->setWriteAccessAccordingly(addr);
 
-		this->setDeviceAddress(addr);
+		// The data memory is not reached by
+		// the table pointer. Leave it as is.
+		if (addr >= PIC18F1XK22_DATA_ADDR) {
+			this->address = addr;
+		} else {
+			this->setDeviceAddress(addr);
+		}
 	}
 }
 
@@ -261,11 +306,11 @@ void PIC18F1XK22_PicProgrammer::eraseDevice()
 
 	// Hold ICSPDAT low whilst erasing
 	// (specified by P11, at least 5 ms)
-	delay(5);
+	PicTiming::delayMillis(5);
 
 	// High voltage discharge time
 	// (specified by P10, at least 100 us)
-	delayMicroseconds(100);
+	PicTiming::delayMicros(100);
 
 	// Write the 16-bit operand to finish
 	// the NOP core instruction.
@@ -276,6 +321,18 @@ void PIC18F1XK22_PicProgrammer::eraseDevice()
 	PicSerial::writeBits(0x0000, 16);
 }
 
+bool PIC18F1XK22_PicProgrammer::eraseRow()
+{
+	// Row erases are not supported. Use
+	// a bulk erase instead.
+	return false;
+}
+
+unsigned int PIC18F1XK22_PicProgrammer::getRowBytes() const
+{
+	return PIC18F1XK22_WRITE_BLOCK_SIZE;
+}
+
 // ------------- INSTRUCTION HELPER FUNC -------------- //
 
 void PIC18F1XK22_PicProgrammer::instructionEntry(unsigned int id, unsigned int operand) const
@@ -354,31 +411,114 @@ void PIC18F1XK22_PicProgrammer::instructionTableWriteStartProg(unsigned int data
 
 // ----------------- HELPER FUNCTIONS ----------------- //
 
-void PIC18F1XK22_PicProgrammer::setDeviceAddress(long long addr) 
+int PIC18F1XK22_PicProgrammer::readDataMemory()
+{
+	// Refer to: 3.3 Read Data EEPROM Memory
+
+	unsigned int addr = (unsigned int)(this->address - PIC18F1XK22_DATA_ADDR) & 0xFF;
+
+	this->instructionCore(0x9EA6);        // BCF EECON1, EEPGD
+	this->instructionCore(0x9CA6);        // BCF EECON1, CFGS
+	this->instructionCore(0x0E00 | addr); // MOVLW addr
+	this->instructionCore(0x6EA9);        // MOVWF EEADR
+	this->instructionCore(0x80A6);        // BSF EECON1, RD
+	this->instructionCore(0x50A8);        // MOVF EEDATA, W
+	this->instructionCore(0x6EF5);        // MOVWF TABLAT
+	this->instructionCore(0x0000);        // NOP
+
+	this->address++;
+	return this->instructionShiftTablat();
+}
+
+void PIC18F1XK22_PicProgrammer::programDataMemory(unsigned char *const writeBuffer, unsigned int numBytes)
+{
+	// Refer to: 4.3 Data EEPROM Programming
+
+	unsigned int addr;
+	unsigned int data;
+	for (unsigned int offset = 0; offset < numBytes; offset++) {
+		addr = (unsigned int)(this->address - PIC18F1XK22_DATA_ADDR) & 0xFF;
+		data = *(writeBuffer + offset);
+
+		this->instructionCore(0x9EA6);        // BCF EECON1, EEPGD
+		this->instructionCore(0x9CA6);        // BCF EECON1, CFGS
+		this->instructionCore(0x0E00 | addr); // MOVLW addr
+		this->instructionCore(0x6EA9);        // MOVWF EEADR
+		this->instructionCore(0x0E00 | data); // MOVLW data
+		this->instructionCore(0x6EA8);        // MOVWF EEDATA
+		this->instructionCore(0x84A6);        // BSF EECON1, WREN
+		this->instructionCore(0x82A6);        // BSF EECON1, WR
+		this->instructionCore(0x0000);        // NOP
+		this->instructionCore(0x0000);        // NOP
+
+		// The write is internally timed. Poll
+		// the WR bit, until it's cleared. Give
+		// up after a while, the read-back will
+		// catch the failed write.
+		for (int i = 0; i < PIC18F1XK22_DATA_WRITE_POLLS; i++) {
+			int eecon1 = this->readRegisterEECON1();
+			if (eecon1 == -1 || !(eecon1 & 0x02))
+				break;
+			PicTiming::delayMillis(1);
+		}
+
+		this->address++;
+	}
+}
+
+int PIC18F1XK22_PicProgrammer::readRegisterEECON1() const
+{
+	this->instructionCore(0x50A6); // MOVF EECON1, W
+	this->instructionCore(0x6EF5); // MOVWF TABLAT
+	this->instructionCore(0x0000); // NOP
+	return this->instructionShiftTablat();
+}
+
+void PIC18F1XK22_PicProgrammer::setDeviceAddress(pic_address_t addr) 
 {
 	// Dis-assemble the address parameter
 	unsigned int addrU = (unsigned int)(addr >> 16) & 0xFF;
 	unsigned int addrH = (unsigned int)(addr >>  8) & 0xFF;
 	unsigned int addrL = (unsigned int)(addr >>  0) & 0xFF;
 
+	// Only load the parts of the table
+	// pointer, which have changed. All
+	// parts are loaded if it's unknown. It's
+	// also unknown after accessing data memory.
+	bool known = this->address >= 0 && this->address < PIC18F1XK22_DATA_ADDR;
+
 	// Load highest bits (addrU)
-	this->instructionCore(0x0E00 | addrU); // MOVLW addrU
-	this->instructionCore(0x6EF8);         // MOVWF TBLPTRU
+	if (!known || addrU != ((this->address >> 16) & 0xFF)) {
+		this->instructionCore(0x0E00 | addrU); // MOVLW addrU
+		this->instructionCore(0x6EF8);         // MOVWF TBLPTRU
+	}
 	
 	// Load middle bits (addrH)
-	this->instructionCore(0x0E00 | addrH); // MOVLW addrH
-	this->instructionCore(0x6EF7);         // MOVWF TBLPTRH
+	if (!known || addrH != ((this->address >> 8) & 0xFF)) {
+		this->instructionCore(0x0E00 | addrH); // MOVLW addrH
+		this->instructionCore(0x6EF7);         // MOVWF TBLPTRH
+	}
 
 	// Load lowest bits (addrL)
-	this->instructionCore(0x0E00 | addrL); // MOVLW addrL
-	this->instructionCore(0x6EF6);         // MOVWF TBLPTRL
+	if (!known || addrL != ((this->address >> 0) & 0xFF)) {
+		this->instructionCore(0x0E00 | addrL); // MOVLW addrL
+		this->instructionCore(0x6EF6);         // MOVWF TBLPTRL
+	}
 
 	// The address has been changed.
 	this->address = addr;
 }
 
-void PIC18F1XK22_PicProgrammer::setWriteAccessAccordingly(long long address) 
+void PIC18F1XK22_PicProgrammer::setWriteAccessAccordingly(pic_address_t address) 
 {
+	// Data memory is accessed with both
+	// EEPGD and CFGS cleared.
+	if (address >= PIC18F1XK22_DATA_ADDR) {
+		this->instructionCore(0x9EA6); // BCF EECON1, EEPGD
+		this->instructionCore(0x9CA6); // BCF EECON1, CFGS
+		return;
+	}
+
 	// Enable access to program flash
 	this->instructionCore(0x8EA6); // BSF EECON1, EEPGD
 
@@ -392,7 +532,7 @@ void PIC18F1XK22_PicProgrammer::setWriteAccessAccordingly(long long address)
 	}
 }
 
-long long PIC18F1XK22_PicProgrammer::getConfigAddress() const 
+pic_address_t PIC18F1XK22_PicProgrammer::getConfigAddress() const 
 {
 	// Refer to: Figure 3-3.
 	return PIC18F1XK22_CONFIG_ADDR;
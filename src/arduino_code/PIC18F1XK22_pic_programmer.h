@@ -13,6 +13,22 @@
 // Address of the configuration memory
 #define PIC18F1XK22_CONFIG_ADDR 0x200000
 
+// Address of the data memory (EEPROM) in
+// the hex file. The data memory is not
+// reached by the table pointer, but is
+// accessed through EEADR and EEDATA.
+#define PIC18F1XK22_DATA_ADDR 0xF00000
+
+// Maximum number of polls of the WR bit,
+// while a byte of data memory is written.
+#define PIC18F1XK22_DATA_WRITE_POLLS 20
+
+// Size of the write block in bytes. The
+// PIC18(L)F13K22 has 8 holding registers
+// and the PIC18(L)F14K22 has 16. Writing
+// a smaller block is always safe.
+#define PIC18F1XK22_WRITE_BLOCK_SIZE 8
+
 // Length of instructions
 #define INSTR_ID_LEN  4
 #define OPERAND_LEN  16
@@ -67,45 +83,51 @@ public:
 
 	// Address related functions
 	virtual void setExtendedAddress(unsigned int extAddr);
-	virtual void setAddress(long long addr);
+	virtual void setAddress(pic_address_t addr);
 	
 	// Device related functions
 	virtual int readDeviceId();
 	virtual void eraseDevice();
+	virtual bool eraseRow();
+	virtual unsigned int getRowBytes() const;
 	
 protected:
 
 	// ------------- INSTRUCTION HELPER FUNC -------------- //
 
-	virtual void instructionEntry(unsigned int id, unsigned int operand) const;
-	virtual int instructionReadEntry(unsigned int id) const;
+	void instructionEntry(unsigned int id, unsigned int operand) const;
+	int instructionReadEntry(unsigned int id) const;
 
 	// ----------------- CORE INSTRUCTION ----------------- //
 
-	virtual void instructionCore(unsigned int operand) const;
+	void instructionCore(unsigned int operand) const;
 
 	// ------ SHIFT OUT TABLAT REGISTER INSTRUCTION ------- //
 
-	virtual int instructionShiftTablat() const;
+	int instructionShiftTablat() const;
 
 	// ------------- TABLE READ INSTRUCTIONS -------------- //
 
-	virtual int instructionTableRead() const;
-	virtual int instructionTableReadPostIncrement() const;
-	virtual int instructionTableReadPostDecrement() const;
-	virtual int instructionTableReadPreIncrement() const;
+	int instructionTableRead() const;
+	int instructionTableReadPostIncrement() const;
+	int instructionTableReadPostDecrement() const;
+	int instructionTableReadPreIncrement() const;
 
 	// ------------ TABLE WRITE INSTRUCTIONS -------------- //
 
-	virtual void instructionTableWrite(unsigned int data) const;
-	virtual void instructionTableWritePostInc(unsigned int data) const;
-	virtual void instructionTableWriteStartProgPostInc(unsigned int data) const;
-	virtual void instructionTableWriteStartProg(unsigned int data) const;
+	void instructionTableWrite(unsigned int data) const;
+	void instructionTableWritePostInc(unsigned int data) const;
+	void instructionTableWriteStartProgPostInc(unsigned int data) const;
+	void instructionTableWriteStartProg(unsigned int data) const;
 
 	// ----------------- HELPER FUNCTIONS ----------------- //
 
-	virtual void setDeviceAddress(long long addr);
-	virtual void setWriteAccessAccordingly(long long address);
-	virtual long long getConfigAddress() const;
+	int readDataMemory();
+	void programDataMemory(unsigned char *const writeBuffer, unsigned int numBytes);
+	int readRegisterEECON1() const;
+
+	void setDeviceAddress(pic_address_t addr);
+	void setWriteAccessAccordingly(pic_address_t address);
+	pic_address_t getConfigAddress() const;
 
 };
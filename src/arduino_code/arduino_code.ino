@@ -1,3 +1,17 @@
+// Placement new is declared by <new>,
+// which cores before ArduinoCore-avr
+// 1.8.3 don't have. Define it there.
+#ifdef __has_include
+#if __has_include(<new>)
+#define HAS_PLACEMENT_NEW
+#endif
+#endif
+#ifdef HAS_PLACEMENT_NEW
+#include <new>
+#else
+inline void *operator new(size_t, void *pointer) { return pointer; }
+#endif
+
 #include "./constants.h"
 #include "./pic_programmer.h"
 
@@ -7,11 +21,49 @@
 #include "./PIC16F88X_pic_programmer.h"
 #include "./PIC16F184XX_pic_programmer.h"
 
+// The programmer is constructed in place
+// in this storage, instead of on the heap.
+// It is sized for the largest specification.
+union ProgrammerStorage {
+  unsigned char pic12f1822[sizeof(PIC12F1822_PicProgrammer)];
+  unsigned char pic18f1xk22[sizeof(PIC18F1XK22_PicProgrammer)];
+  unsigned char pic16f88x[sizeof(PIC16F88X_PicProgrammer)];
+  unsigned char pic16f184xx[sizeof(PIC16F184XX_PicProgrammer)];
+  // Aligns the storage for all members
+  // of the programmers.
+  pic_address_t alignment;
+  void *pointer;
+};
+
+ProgrammerStorage programmerStorage;
 PicProgrammer *programmer = nullptr;
 
 unsigned int writeBufferSize = 0;
 unsigned char writeBuffer[WRITE_BUFFER_SIZE];
 
+// The current baudrate, and the baudrate
+// to change to after the 'u' command.
+unsigned long transferBaudrate = TRANSFER_BAUDRATE;
+unsigned long pendingBaudrate = 0;
+
+// Test pattern echoed at a new baudrate
+const unsigned char baudratePattern[] = { 0x55, 0xAA, 0x00, 0xFF, 0x0F, 0x3C };
+
+// Bytes moved out of the serial buffer
+// during programming delays. The next
+// block is received here, while the
+// current one is programmed.
+unsigned char receiveBuffer[RECEIVE_BUFFER_SIZE];
+unsigned int receiveHead = 0;
+unsigned int receiveTail = 0;
+
+// Counters of where the time is spent.
+// They are sent by the 'q' command.
+unsigned long commandsHandled = 0;
+unsigned long serialBytesIn = 0;
+unsigned long serialBytesOut = 0;
+unsigned long serialWaitMicros = 0;
+
 void setup() {
   // Set to input when 
   // not programming.
@@ -24,13 +76,17 @@ void setup() {
 
   Serial.begin(TRANSFER_BAUDRATE);
 
+  PicTiming::idleHandler = receiveSerial;
+
   // Send power good signal
   Serial.print('g');
 }
 
 void loop() {
-  if (Serial.available() > 0) {
-    char command = Serial.read();
+  receiveSerial();
+
+  if (receiveAvailable() > 0) {
+    char command = receiveByte();
 
     // Sometimes it seems like the serial
     // is sending 0xF0 as a leading byte to
@@ -38,10 +94,18 @@ void loop() {
     if (command == (char)0xF0)
       return;
 
+    commandsHandled++;
+
     // Print back received command
-    Serial.print(command);
+    sendByte(command);
     // Print command status, when done
-    Serial.print(doCommand(command) ? 'd' : 'f');
+    sendByte(doCommand(command) ? 'd' : 'f');
+
+    // The status is sent at the old rate
+    if (pendingBaudrate != 0) {
+      changeBaudrate(pendingBaudrate);
+      pendingBaudrate = 0;
+    }
   }
 }
 
@@ -51,16 +115,14 @@ bool doCommand(char command) {
     
     if (programmer != nullptr) {
       if (programmer->programming) {
-        Serial.write(0x00);
-        Serial.write(0x00);
+        sendArgument(0, BEGIN_RESPONSE_SIZE);
         return false;
       }
 
-      // We have to delete the programmer.
+      // We have to destroy the programmer.
       // For some reason it never started
       // programming.
-      delete programmer;
-      programmer = nullptr;
+      destroyProgrammer();
     }
 
     // We send back flags depending
@@ -76,21 +138,22 @@ bool doCommand(char command) {
     // specification.
     switch (mode & 0x3F) {
     case PIC12F1822_SPECIFICATION:
-      programmer = new PIC12F1822_PicProgrammer(mode);
+      programmer = new (&programmerStorage) PIC12F1822_PicProgrammer(mode);
       break;
     case PIC18F1XK22_SPECIFICATION:
-      programmer = new PIC18F1XK22_PicProgrammer(mode);
+      programmer = new (&programmerStorage) PIC18F1XK22_PicProgrammer(mode);
 
       // Use single byte per address
       twoBytesPerAddr = false;
       break;
     case PIC16F88X_SPECIFICATION:
-      programmer = new PIC16F88X_PicProgrammer(mode);
+      programmer = new (&programmerStorage) PIC16F88X_PicProgrammer(mode);
       break;
     case PIC16F184XX_SPECIFICATION:
-      programmer = new PIC16F184XX_PicProgrammer(mode);
+      programmer = new (&programmerStorage) PIC16F184XX_PicProgrammer(mode);
       break;
     default:
+      sendArgument(0, BEGIN_RESPONSE_SIZE);
       return false;
     }
 
@@ -99,9 +162,13 @@ bool doCommand(char command) {
 
     unsigned int flags = twoBytesPerAddr ? TWO_BYTES_PER_ADDRESS : 0;
 
-    // Send flags to transmitter
-    Serial.write((char)(flags >> 8));
-    Serial.write((char)(flags >> 0));
+    // Send flags to transmitter, followed
+    // by the buffer sizes and the number
+    // of bytes programmed per row.
+    sendArgument(flags, 2);
+    sendArgument(WRITE_BUFFER_SIZE, 2);
+    sendArgument(RECEIVE_BUFFER_SIZE, 2);
+    sendArgument(programmer->getRowBytes(), 2);
 
     // Set programming pins as output.
     // The MCLR pin has to be set by
@@ -110,16 +177,40 @@ bool doCommand(char command) {
     // output.
     pinMode(PVCC,    OUTPUT);
     pinMode(ICSPCLK, OUTPUT);
-    pinMode(ICSPDAT, OUTPUT);
     pinMode(PGM,     OUTPUT);
 
     digitalWrite(PVCC,    LOW);
     digitalWrite(ICSPCLK, LOW);
-    digitalWrite(ICSPDAT, LOW);
     digitalWrite(PGM,     LOW);
 
+    // Data pins of all targets are
+    // set as low outputs.
+    PicSerial::writeMode();
+
     return programmer->enterProgrammingMode();
   }
+
+  if (command == 'u') {
+    // The baudrate is changed, after the
+    // status has been sent.
+    unsigned long baudrate = readArgument(4);
+    if (baudrate != NEGOTIATED_BAUDRATE_0 && 
+        baudrate != NEGOTIATED_BAUDRATE_1 && 
+        baudrate != NEGOTIATED_BAUDRATE_2 &&
+        baudrate != TRANSFER_BAUDRATE) {
+      return false;
+    }
+
+    pendingBaudrate = baudrate;
+    return true;
+  }
+
+  if (command == 'q') {
+    // Statistics are available, even
+    // when not programming.
+    sendStatistics();
+    return true;
+  }
   
   if (programmer == nullptr || !programmer->programming)
     return false;
@@ -134,22 +225,33 @@ bool doCommand(char command) {
 
     pinMode(PVCC,    INPUT);
     pinMode(ICSPCLK, INPUT);
-    pinMode(ICSPDAT, INPUT);
     pinMode(PGM,     INPUT);
 
-    // Delete the programmer
-    delete programmer;
-    programmer = nullptr;
+    PicSerial::readMode();
+
+    // Destroy the programmer
+    destroyProgrammer();
 
     return true;
   
   case 'n':
+    // Targets are compared from the
+    // beginning of each read.
+    PicSerial::mismatchedPins = 0;
     programmer->beginReading();
     return true;
   case 'r':
     tmp = programmer->readProgramWord();
-    Serial.write((char)(tmp >> 8));
-    Serial.write((char)(tmp >> 0));
+    sendByte((char)(tmp >> 8));
+    sendByte((char)(tmp >> 0));
+    return true;
+  case 'R':
+    streamProgramWords(readArgument(2));
+    return true;
+  case 'c':
+    tmp = checksumProgramWords(readArgument(2));
+    sendByte((char)(tmp >> 8));
+    sendByte((char)(tmp >> 0));
     return true;
   case 'm':
     programmer->endReading();
@@ -173,6 +275,28 @@ bool doCommand(char command) {
     // Clear write-buffer
     writeBufferSize = 0;
 
+    return true;
+  case 'w':
+    // Load a whole block into the
+    // write-buffer and program it.
+    if (!readWriteBlock())
+      return false;
+
+    programmer->programWriteBuffer(writeBuffer, writeBufferSize);
+    // Clear write-buffer
+    writeBufferSize = 0;
+
+    return true;
+  case 'z':
+    // Like 'w', but the block is run-
+    // length encoded.
+    if (!readCompressedBlock())
+      return false;
+
+    programmer->programWriteBuffer(writeBuffer, writeBufferSize);
+    // Clear write-buffer
+    writeBufferSize = 0;
+
     return true;
   case 'k':
     programmer->endWriting();
@@ -189,24 +313,288 @@ bool doCommand(char command) {
 
   case 'i':
     tmp = programmer->readDeviceId();
-    Serial.write((char)(tmp >> 8));
-    Serial.write((char)(tmp >> 0));
+    sendByte((char)(tmp >> 8));
+    sendByte((char)(tmp >> 0));
     return true;
   case 'e': 
     programmer->eraseDevice();
     return true;
+  case 'E':
+    return programmer->eraseRow();
+
+  case 'v':
+    sendTargetResults();
+    return true;
   }
 
   return false;
 }
 
+void destroyProgrammer() {
+  // The storage is not freed, only
+  // the programmer is destructed.
+  programmer->~PicProgrammer();
+  programmer = nullptr;
+}
+
 unsigned long readArgument(unsigned int num) {
   unsigned long r = 0;
   while (num--) {
-    while (Serial.available() == 0)
-      continue;
+    if (receiveAvailable() == 0) {
+      // Only time the wait, when the
+      // data has not arrived yet.
+      unsigned long start = micros();
+      while (receiveAvailable() == 0)
+        receiveSerial();
+      serialWaitMicros += micros() - start;
+    }
     r <<= 8;
-    r |= Serial.read() & 0xFF;
+    r |= receiveByte();
   }
   return r;
 }
+
+bool readCompressedBlock() {
+  // The encoded block is framed like a
+  // 'w' block. A token below 80h is
+  // followed by (token + 1) literal bytes.
+  // Otherwise it is followed by a two byte
+  // unit, repeated ((token & 7Fh) + 1)
+  // times. Tokens are expanded directly
+  // into the write-buffer.
+  unsigned int numBytes = readArgument(2);
+  unsigned char checksum = (numBytes >> 8) + numBytes;
+
+  // The entire block has to be consumed,
+  // even if it is malformed.
+  bool valid = true;
+  unsigned int size = 0;
+  while (numBytes > 0) {
+    unsigned char token = readArgument(1);
+    checksum += token;
+    numBytes--;
+
+    unsigned int count = (token & 0x7F) + 1;
+    if (token < 0x80) {
+      if (count > numBytes)
+        valid = false;
+
+      while (count-- > 0 && numBytes > 0) {
+        unsigned char data = readArgument(1);
+        checksum += data;
+        numBytes--;
+
+        if (size < WRITE_BUFFER_SIZE)
+          writeBuffer[size++] = data;
+        else
+          valid = false;
+      }
+    } else {
+      if (numBytes < 2) {
+        valid = false;
+        continue;
+      }
+
+      unsigned char data0 = readArgument(1);
+      unsigned char data1 = readArgument(1);
+      checksum += data0 + data1;
+      numBytes -= 2;
+
+      while (count-- > 0) {
+        if (size + 2 <= WRITE_BUFFER_SIZE) {
+          writeBuffer[size++] = data0;
+          writeBuffer[size++] = data1;
+        } else {
+          valid = false;
+        }
+      }
+    }
+  }
+  checksum += readArgument(1);
+
+  // Don't keep corrupted data around
+  // for a later 'p' command.
+  if (!valid || checksum != 0) {
+    writeBufferSize = 0;
+    return false;
+  }
+
+  writeBufferSize = size;
+  return true;
+}
+
+void changeBaudrate(unsigned long baudrate) {
+  Serial.flush();
+  Serial.end();
+  Serial.begin(baudrate);
+
+  // Fall back to the previous rate, if
+  // the transmitter did not confirm it.
+  if (!echoBaudratePattern()) {
+    Serial.flush();
+    Serial.end();
+    Serial.begin(transferBaudrate);
+  } else {
+    transferBaudrate = baudrate;
+  }
+
+  // Drop anything received during the
+  // change of baudrate.
+  receiveTail = receiveHead;
+  while (Serial.available() > 0)
+    Serial.read();
+}
+
+bool echoBaudratePattern() {
+  // Every byte of the pattern is echoed
+  // back, and the transmitter confirms it
+  // received the echo.
+  unsigned int received = 0;
+
+  unsigned long start = millis();
+  while (millis() - start < BAUDRATE_TIMEOUT_MS) {
+    if (Serial.available() == 0)
+      continue;
+
+    unsigned char data = Serial.read();
+    if (received == sizeof(baudratePattern))
+      return data == BAUDRATE_CONFIRM;
+    if (data != baudratePattern[received++])
+      return false;
+
+    Serial.write(data);
+  }
+
+  return false;
+}
+
+void receiveSerial() {
+  // Move everything received into the
+  // receive buffer, while there's space.
+  while (Serial.available() > 0 && receiveAvailable() < RECEIVE_BUFFER_SIZE) {
+    receiveBuffer[receiveHead & (RECEIVE_BUFFER_SIZE - 1)] = Serial.read();
+    receiveHead++;
+  }
+}
+
+unsigned int receiveAvailable() {
+  return receiveHead - receiveTail;
+}
+
+unsigned char receiveByte() {
+  // Assumes a byte is available
+  serialBytesIn++;
+  return receiveBuffer[receiveTail++ & (RECEIVE_BUFFER_SIZE - 1)];
+}
+
+void sendByte(char data) {
+  Serial.write(data);
+  serialBytesOut++;
+}
+
+void sendArgument(unsigned long data, unsigned int num) {
+  // Arguments are sent MSB first, the
+  // same way as they are read.
+  while (num--)
+    sendByte((char)(data >> (num * 8)));
+}
+
+void sendStatistics() {
+  sendArgument(commandsHandled, 4);
+  sendArgument(PicSerial::clockedBits, 4);
+  sendArgument(PicTiming::delayedMicros, 4);
+  sendArgument(serialBytesIn, 4);
+  sendArgument(serialBytesOut, 4);
+  sendArgument(serialWaitMicros, 4);
+  sendArgument(PicProgrammer::skippedWords, 4);
+
+  // Statically reserved memory
+  sendArgument(sizeof(programmerStorage), 4);
+  sendArgument(WRITE_BUFFER_SIZE, 4);
+  sendArgument(RECEIVE_BUFFER_SIZE, 4);
+}
+
+void sendTargetResults() {
+  // The number of targets, followed by a
+  // byte with a bit per target, set if it
+  // read differently from the primary
+  // target (bit 0) since the last 'n'.
+  unsigned char numTargets = 1;
+  unsigned char failedTargets = 0;
+#ifdef ICSP_GANG_DATA_MASK
+  for (unsigned char pin = 0; pin < 8; pin++) {
+    if (!(ICSP_GANG_DATA_MASK & (1 << pin)))
+      continue;
+
+    if (PicSerial::mismatchedPins & (1 << pin))
+      failedTargets |= 1 << numTargets;
+    numTargets++;
+  }
+#endif
+
+  sendByte(numTargets);
+  sendByte(failedTargets);
+}
+
+void streamProgramWords(unsigned int numWords) {
+  // Words are sent in the same format as
+  // the 'r' command, followed by a checksum
+  // byte making the sum of the response
+  // zero.
+  unsigned char checksum = 0;
+  while (numWords--) {
+    // Keep receiving the next commands
+    receiveSerial();
+
+    unsigned int data = programmer->readProgramWord();
+    sendByte((char)(data >> 8));
+    sendByte((char)(data >> 0));
+    checksum += (data >> 8) + data;
+  }
+  sendByte((char)(-checksum));
+}
+
+unsigned int checksumProgramWords(unsigned int numWords) {
+  // Words are checksummed MSB first as
+  // they would have been sent by 'R'.
+  unsigned int crc = 0xFFFF;
+  while (numWords--) {
+    receiveSerial();
+
+    unsigned int data = programmer->readProgramWord();
+    crc = PicMemory::crc16(crc, data >> 8);
+    crc = PicMemory::crc16(crc, data >> 0);
+  }
+  return crc;
+}
+
+bool readWriteBlock() {
+  // A block is sent as a two byte length,
+  // the data and a checksum byte. Like in
+  // hex files, the sum of all bytes in the
+  // block (including checksum) is zero.
+  unsigned int numBytes = readArgument(2);
+  unsigned char checksum = (numBytes >> 8) + numBytes;
+
+  // The entire block has to be consumed,
+  // even if it does not fit. Otherwise the
+  // data would be read as commands.
+  bool fits = numBytes <= WRITE_BUFFER_SIZE;
+  for (unsigned int i = 0; i < numBytes; i++) {
+    unsigned char data = readArgument(1);
+    if (fits)
+      writeBuffer[i] = data;
+    checksum += data;
+  }
+  checksum += readArgument(1);
+
+  // Don't keep corrupted data around
+  // for a later 'p' command.
+  if (!fits || checksum != 0) {
+    writeBufferSize = 0;
+    return false;
+  }
+
+  writeBufferSize = numBytes;
+  return true;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <Arduino.h>
+
 // Pins used for programming
 // and serial communication.
 #define MCLR       2
@@ -8,10 +10,99 @@
 #define PVCC       5
 #define PGM        6
 
+// On ATmega328P/168 based boards (Uno,
+// Nano, Pro Mini) digital pins 0-7 are
+// mapped directly to PORTD. The serial
+// pins are then driven through the port
+// registers instead of digitalWrite.
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+#if ICSPCLK > 7 || ICSPDAT > 7
+#error "ICSPCLK and ICSPDAT have to be located on PORTD (pins 0-7)"
+#endif
+#define ICSP_PORT_REGISTERS
+#define ICSP_PORT  PORTD
+#define ICSP_DDR   DDRD
+#define ICSP_PIN   PIND
+#endif
+
+// Gang programming of identical targets
+// in lock-step. All targets share MCLR,
+// PVCC, PGM and ICSPCLK, but each extra
+// target has its own data pin on the port
+// of ICSPDAT, given by this mask of port
+// bits. The data pins are driven together
+// and sampled by a single read of the
+// port. MCLR, PVCC and PGM can be moved
+// off the port to free pins.
+//#define ICSP_GANG_DATA_MASK (1 << 7)
+#ifdef ICSP_GANG_DATA_MASK
+#ifndef ICSP_PORT_REGISTERS
+#error "Gang programming requires ICSPCLK and ICSPDAT on a port register"
+#endif
+// Every pin of the mask is driven with
+// the data, so it can't share a pin with
+// the power, MCLR or PGM of the targets.
+#if ICSP_GANG_DATA_MASK & ((1 << ICSPCLK) | (1 << ICSPDAT) | (1 << MCLR) | (1 << PVCC) | (1 << PGM) | 0x03)
+#error "ICSP_GANG_DATA_MASK overlaps ICSPCLK, ICSPDAT, MCLR, PVCC, PGM or the serial pins"
+#endif
+#endif
+
+// The minimum setup, hold, clock high
+// and clock low time of the serial pins
+// in nanoseconds. All specifications
+// require at most 100 ns (TDS, TDH, TCKH
+// and TCKL) and drive data within 80 ns
+// of the rising clock edge (TCO).
+#define ICSP_MIN_EDGE_TIME_NS 100
+
 #define TRANSFER_BAUDRATE 115200
-// The number of bytes available
-// in the write buffer for programming.
-#define WRITE_BUFFER_SIZE 32
+
+// Baudrates which can be negotiated by
+// the 'u' command. All of them are exact
+// on a 16 MHz AVR.
+#define NEGOTIATED_BAUDRATE_0 250000
+#define NEGOTIATED_BAUDRATE_1 500000
+#define NEGOTIATED_BAUDRATE_2 1000000
+// The time given to the transmitter to
+// confirm a new baudrate, before falling
+// back to the previous one.
+#define BAUDRATE_TIMEOUT_MS 200
+// The byte sent by the transmitter, when
+// it received the echoed test pattern.
+#define BAUDRATE_CONFIRM 'y'
+
+// The number of bytes available in the
+// write buffer for programming, and the
+// number of bytes received ahead, while
+// the previous block is being programmed.
+// The receive buffer must be a power of
+// two, and hold two of the largest 'w'
+// frames (block and 4 bytes of framing).
+// Otherwise the next block can't arrive
+// while the current one is programmed.
+// Both are sized by the SRAM of the
+// board, and reported by the 'b' command.
+#if defined(RAMEND) && RAMEND < 0x800
+// ATmega168 (1K SRAM)
+#define WRITE_BUFFER_SIZE   32
+#define RECEIVE_BUFFER_SIZE 128
+#elif defined(RAMEND) && RAMEND < 0x1000
+// ATmega328P (2K SRAM)
+#define WRITE_BUFFER_SIZE   64
+#define RECEIVE_BUFFER_SIZE 256
+#else
+// ATmega2560 (8K SRAM) and larger
+#define WRITE_BUFFER_SIZE   256
+#define RECEIVE_BUFFER_SIZE 1024
+#endif
+
+#if RECEIVE_BUFFER_SIZE < 2 * (WRITE_BUFFER_SIZE + 4)
+#error "RECEIVE_BUFFER_SIZE has to hold two frames of WRITE_BUFFER_SIZE"
+#endif
+
+// The number of bytes sent in response
+// to the 'b' command.
+#define BEGIN_RESPONSE_SIZE 8
 
 // Flags sent by the transmitter to 
 // the Arduino.
@@ -26,6 +26,22 @@ public:
 		return *(data + offset);
 	}
 
+	static unsigned int crc16(unsigned int crc, unsigned char data)
+	{
+		// CRC-16/CCITT (polynomial 1021h),
+		// calculated bitwise to keep the
+		// flash footprint small.
+		crc ^= (unsigned int)data << 8;
+		for (unsigned char i = 0; i < 8; i++) {
+			if (crc & 0x8000) {
+				crc = (crc << 1) ^ 0x1021;
+			} else {
+				crc <<= 1;
+			}
+		}
+		return crc;
+	}
+
 private:
 	// PicSerial is a static class.
 	PicMemory() { };
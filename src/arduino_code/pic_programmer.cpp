@@ -1,5 +1,7 @@
 #include "./pic_programmer.h"
 
+unsigned long PicProgrammer::skippedWords = 0;
+
 PicProgrammer::PicProgrammer(unsigned int flags)
 	: programming(false),
 	  lowVoltageMode((flags & LOW_VOLTAGE_PROGRAMMING_MASK) != 0),
@@ -1,19 +1,35 @@
 #pragma once
 
 #include "./pic_serial.h"
+#include "./pic_timing.h"
 
 // The byte offset specified by 
 // the extended address.
 #define EXTENDED_ADDRESS_BYTE_OFFSET 0x10000L
 
+// Device addresses. None of the devices
+// use more than 22 bits, so 32 bits keep
+// the arithmetic short on 8-bit cores.
+// An unknown address is -1. The host
+// build overrides the type to measure
+// the cost (see test/host/address_width.sh).
+#ifndef PIC_ADDRESS_TYPE
+#define PIC_ADDRESS_TYPE long
+#endif
+typedef PIC_ADDRESS_TYPE pic_address_t;
+
 class PicProgrammer 
 {
 
 public:
+	// The erased program words of the write
+	// buffers, which were not programmed.
+	static unsigned long skippedWords;
+
 	bool programming;
 	bool lowVoltageMode;
 
-	long long address;
+	pic_address_t address;
 	unsigned int extendedAddress;
 
 protected:
@@ -39,9 +55,14 @@ public:
 
 	// Address related functions
 	virtual void setExtendedAddress(unsigned int extAddr) = 0;
-	virtual void setAddress(long long addr) = 0;
+	virtual void setAddress(pic_address_t addr) = 0;
 	
 	// Device related functions
 	virtual int readDeviceId() = 0;
 	virtual void eraseDevice() = 0;
+	virtual bool eraseRow() = 0;
+
+	// The number of bytes programmed by a
+	// single programming cycle (row).
+	virtual unsigned int getRowBytes() const = 0;
 };
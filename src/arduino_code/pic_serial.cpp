@@ -0,0 +1,4 @@
+#include "./pic_serial.h"
+
+unsigned long PicSerial::clockedBits = 0;
+unsigned char PicSerial::mismatchedPins = 0;
@@ -3,6 +3,20 @@
 #include <Arduino.h>
 
 #include "./constants.h"
+#include "./pic_timing.h"
+
+// The number of cpu cycles needed to
+// cover the minimum edge time of the
+// serial pins (rounded up).
+#define ICSP_EDGE_CYCLES ((ICSP_MIN_EDGE_TIME_NS * (F_CPU / 1000000UL) + 999) / 1000)
+
+// The port bits of the data pins of all
+// targets, when using port registers.
+#ifdef ICSP_GANG_DATA_MASK
+#define ICSP_DATA_MASK ((1 << ICSPDAT) | ICSP_GANG_DATA_MASK)
+#else
+#define ICSP_DATA_MASK (1 << ICSPDAT)
+#endif
 
 // ----------------- SERIAL PROTOCOLS ----------------- //
 
@@ -10,52 +24,73 @@ class PicSerial
 {
 
 public:
+	// The total number of bits clocked
+	// in and out. Counted per call, not
+	// per bit, to keep it off the edges.
+	static unsigned long clockedBits;
+
+	// The gang data pins, which have read
+	// a different bit than the primary
+	// target. Always zero without gang
+	// programming.
+	static unsigned char mismatchedPins;
 
 	static void readMode() 
 	{
 		// Changed the data-pin to an
 		// input.
+#ifdef ICSP_PORT_REGISTERS
+		// The port bit is always low
+		// here, so no pull-up is enabled.
+		ICSP_DDR &= ~ICSP_DATA_MASK;
+#else
 		pinMode(ICSPDAT, INPUT);
+#endif
 	}
 
 	static void writeMode() 
 	{
 		// Changes the data-pin to an
 		// output. Default LOW.
+#ifdef ICSP_PORT_REGISTERS
+		ICSP_PORT &= ~ICSP_DATA_MASK;
+		ICSP_DDR  |=  ICSP_DATA_MASK;
+#else
 		pinMode(ICSPDAT, OUTPUT);
 		digitalWrite(ICSPDAT, LOW);
+#endif
 	}
 
 	static void writeBits(unsigned long data, unsigned int n) 
 	{
+		clockedBits += n;
+
 		// Write bits in LSb first
 		while (n--) {
-			writeBit(data & 0x1);
+			clockOutBit(data & 0x1);
 			data >>= 1;
 		}
+		dataLow();
+		transferDone();
 	}
 
 	static void writeBitsMSBF(unsigned long data, unsigned int n) 
 	{
+		clockedBits += n;
+
 		while (n--)
-			writeBit((data >> n) & 0x1);
+			clockOutBit((data >> n) & 0x1);
+		dataLow();
+		transferDone();
 	}
 
 	static void writeBit(bool data) 
 	{
-		// A bit is written by first
-		// setting the data pin high or low
-		// and sending a pulse on the clk
-		// pin. data-pin is set low after
+		// data-pin is set low after
 		// to make sure it's low by default.
-
-		digitalWrite(ICSPDAT, data ? HIGH : LOW);
-		delayMicroseconds(1);
-		digitalWrite(ICSPCLK, HIGH);
-		delayMicroseconds(1);
-		digitalWrite(ICSPCLK,  LOW);
-		delayMicroseconds(1);
-		digitalWrite(ICSPDAT, LOW);
+		clockedBits++;
+		clockOutBit(data);
+		dataLow();
 	}
 
 	static unsigned int readBits(unsigned int n) 
@@ -72,42 +107,149 @@ public:
 		// to an unsigned long as well
 		// as the return type.
 		unsigned int data = 0;
+		clockedBits += n;
 		
 		unsigned int i = 0;
 		while (i < n)
-			data |= readBit() << i++;
+			data |= clockInBit() << i++;
 		
+		transferDone();
 		return data;
 	}
 
 	static unsigned int readBitsMSBF(unsigned int n) 
 	{
 		unsigned int data = 0;
+		clockedBits += n;
 
 		while (n--) {
 			data <<= 1;
-			data |= readBit();
+			data |= clockInBit();
 		}
 
+		transferDone();
 		return data;
 	}
 
 	static unsigned int readBit() 
 	{
-		// Reading a bit is a lot like
-		// writing a bit, except the data
-		// pin is now an input. The clk
-		// pin is still timed externally.
+		clockedBits++;
+		return clockInBit();
+	}
+
+	// --------------- PIN HELPER FUNCTIONS --------------- //
+
+	static void clockHigh()
+	{
+#ifdef ICSP_PORT_REGISTERS
+		ICSP_PORT |= (1 << ICSPCLK);
+#else
 		digitalWrite(ICSPCLK, HIGH);
-		delayMicroseconds(1);
-		unsigned int data = digitalRead(ICSPDAT);
-		delayMicroseconds(1);
+#endif
+	}
+
+	static void clockLow()
+	{
+#ifdef ICSP_PORT_REGISTERS
+		ICSP_PORT &= ~(1 << ICSPCLK);
+#else
 		digitalWrite(ICSPCLK, LOW);
-		delayMicroseconds(1);
-		return data ? 1 : 0;
+#endif
+	}
+
+	static void dataLow()
+	{
+#ifdef ICSP_PORT_REGISTERS
+		ICSP_PORT &= ~ICSP_DATA_MASK;
+#else
+		digitalWrite(ICSPDAT, LOW);
+#endif
 	}
 
 	private:
 		// PicSerial is a static class.
 		PicSerial() { };
+
+		static void clockOutBit(bool data)
+		{
+			// A bit is written by first
+			// setting the data pin high or low
+			// and sending a pulse on the clk
+			// pin. Each edge is held for the
+			// minimum setup / hold time.
+#ifdef ICSP_PORT_REGISTERS
+			if (data) {
+				ICSP_PORT |= ICSP_DATA_MASK;
+			} else {
+				ICSP_PORT &= ~ICSP_DATA_MASK;
+			}
+#else
+			digitalWrite(ICSPDAT, data ? HIGH : LOW);
+#endif
+			edgeDelay();
+			clockHigh();
+			edgeDelay();
+			clockLow();
+			edgeDelay();
+		}
+
+		static unsigned int clockInBit()
+		{
+			// Reading a bit is a lot like
+			// writing a bit, except the data
+			// pin is now an input. The clk
+			// pin is still timed externally.
+			clockHigh();
+			// Data is valid TCO after the
+			// rising edge.
+			edgeDelay();
+			unsigned int data = readData();
+			edgeDelay();
+			clockLow();
+			edgeDelay();
+			return data;
+		}
+
+		static unsigned int readData()
+		{
+#ifdef ICSP_PORT_REGISTERS
+			unsigned char pins = ICSP_PIN;
+			unsigned int data = (pins >> ICSPDAT) & 0x1;
+#ifdef ICSP_GANG_DATA_MASK
+			// The other targets were sampled on
+			// the same edge. Record the ones that
+			// disagree with the primary target.
+			mismatchedPins |= (data ? ~pins : pins) & ICSP_GANG_DATA_MASK;
+#endif
+			return data;
+#else
+			return digitalRead(ICSPDAT) ? 1 : 0;
+#endif
+		}
+
+		static void edgeDelay()
+		{
+#ifdef ICSP_PORT_REGISTERS
+			// Each port write is already
+			// two cycles, but don't rely
+			// on the compiler for timing.
+			__builtin_avr_delay_cycles(ICSP_EDGE_CYCLES);
+#else
+			// digitalWrite is slow enough
+			// on most boards. Keep a safe
+			// margin for faster cores.
+			delayMicroseconds(1);
+#endif
+		}
+
+		static void transferDone()
+		{
+#ifndef ICSP_PORT_REGISTERS
+			// Commands take long enough with
+			// digitalWrite to fill the serial
+			// buffer at the faster baudrates.
+			// Receive after every transfer.
+			PicTiming::idle();
+#endif
+		}
 };
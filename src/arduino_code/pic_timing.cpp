@@ -0,0 +1,4 @@
+#include "./pic_timing.h"
+
+unsigned long PicTiming::delayedMicros = 0;
+void (*PicTiming::idleHandler)() = nullptr;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ----------------- TIMING FUNCTIONS ----------------- //
+
+class PicTiming
+{
+
+public:
+	// The total time, in microseconds, spent
+	// in the delays of the specifications
+	// (programming, erase, setup and hold).
+	static unsigned long delayedMicros;
+
+	// Called repeatedly while waiting in
+	// millisecond delays, if set. Used to
+	// receive data during programming.
+	static void (*idleHandler)();
+
+	static void delayMillis(unsigned long ms)
+	{
+		delayedMicros += ms * 1000;
+
+		if (idleHandler == nullptr) {
+			delay(ms);
+			return;
+		}
+
+		// The delays are minimum times, so
+		// the handler may overrun them.
+		unsigned long start = micros();
+		while (micros() - start < ms * 1000)
+			idleHandler();
+	}
+
+	// Lets the handler receive data between
+	// the words of long operations, which
+	// have no millisecond delays.
+	static void idle()
+	{
+		if (idleHandler != nullptr)
+			idleHandler();
+	}
+
+	static void delayMicros(unsigned int us)
+	{
+		delayedMicros += us;
+		delayMicroseconds(us);
+	}
+
+private:
+	// PicTiming is a static class.
+	PicTiming() { };
+};
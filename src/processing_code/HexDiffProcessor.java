@@ -0,0 +1,198 @@
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+
+public class HexDiffProcessor extends HexProcessor {
+	
+	/** Value of an erased program word */
+	public static final int ERASED_WORD = 0x3FFF;
+	
+	/** The number of words erased by a row erase,
+	  * zero if row erases are not supported. */
+	private final int rowSize;
+	/** The word address of the configuration memory */
+	private final int configAddress;
+	
+	/** The words of the hex file by row, -1 where
+	  * the hex file has no data. */
+	private final Map<Integer, int[]> rows;
+	private int extendedAddress;
+	
+	public HexDiffProcessor(Programmer programmer, boolean twoBytesPerAddress, HexFile hex, int rowSize, int configAddress) {
+		super(programmer, twoBytesPerAddress, hex);
+
+		this.rowSize = rowSize;
+		this.configAddress = configAddress;
+
+		rows = new TreeMap<Integer, int[]>();
+	}
+	
+	@Override
+	public void processHexFile() {
+		// Row erases only work on devices
+		// with two bytes per address.
+		if (rowSize == 0 || !twoBytesPerAddress) {
+			System.out.println("Row erase not supported, programming entire device...");
+			programEntireDevice();
+			return;
+		}
+
+		// Collect the rows of the hex file
+		rows.clear();
+		extendedAddress = 0;
+		super.processHexFile();
+
+		System.out.println("Comparing " + rows.size() + " rows...");
+
+		List<Integer> changedRows = new ArrayList<Integer>();
+		int numProgramRows = 0;
+		boolean configChanged = false;
+
+		programmer.beginReading();
+		for (Map.Entry<Integer, int[]> row : rows.entrySet()) {
+			int rowAddress = row.getKey() * rowSize;
+			if (rowAddress >= configAddress) {
+				// The configuration memory can't be
+				// row erased. Only compare the words
+				// in the hex file.
+				if (!matchesWords(rowAddress, row.getValue()))
+					configChanged = true;
+			} else {
+				numProgramRows++;
+				if (!matchesChecksum(rowAddress, row.getValue()))
+					changedRows.add(row.getKey());
+			}
+		}
+		programmer.endReading();
+
+		// If most rows changed, a bulk erase
+		// and a full rewrite is faster.
+		if (configChanged || changedRows.size() * 2 > numProgramRows) {
+			System.out.println("Most rows or configuration changed, programming entire device...");
+			programEntireDevice();
+			return;
+		}
+
+		System.out.println("Programming " + changedRows.size() + " changed rows...");
+
+		programmer.beginWriting();
+		for (int rowIndex : changedRows) {
+			int rowAddress = rowIndex * rowSize;
+			setWordAddress(rowAddress);
+			programmer.eraseRow();
+
+			programRow(rowAddress, rows.get(rowIndex));
+		}
+		programmer.endWriting();
+
+		System.out.println("Finished differential programming...");
+	}
+	
+	private void programEntireDevice() {
+		programmer.eraseDevice();
+		new HexWriteProcessor(programmer, twoBytesPerAddress, hex).processHexFile();
+	}
+	
+	private boolean matchesChecksum(int rowAddress, int[] words) {
+		// Words not in the hex file will be
+		// erased, if the row is reprogrammed.
+		int crc = 0xFFFF;
+		for (int word : words) {
+			if (word == -1)
+				word = ERASED_WORD;
+			crc = MemoryUtil.crc16(crc, word >>> 8);
+			crc = MemoryUtil.crc16(crc, word);
+		}
+
+		setWordAddress(rowAddress);
+		return programmer.checksumProgramWords(words.length) == crc;
+	}
+	
+	private boolean matchesWords(int rowAddress, int[] words) {
+		int i = 0;
+		while (i < words.length) {
+			// Find the next run of words
+			if (words[i] == -1) {
+				i++;
+				continue;
+			}
+			int runStart = i;
+			while (i < words.length && words[i] != -1)
+				i++;
+
+			setWordAddress(rowAddress + runStart);
+			byte[] programmedWords = programmer.readProgramWords(i - runStart);
+			for (int j = runStart; j < i; j++) {
+				int programmedWord = MemoryUtil.bytesToUnsignedShort(programmedWords, (j - runStart) * 2, true);
+				if (programmedWord != words[j])
+					return false;
+			}
+		}
+		return true;
+	}
+	
+	private void programRow(int rowAddress, int[] words) {
+		int i = 0;
+		while (i < words.length) {
+			// Find the next run of words
+			if (words[i] == -1) {
+				i++;
+				continue;
+			}
+			int runStart = i;
+			while (i < words.length && words[i] != -1)
+				i++;
+
+			// Words are programmed little endian
+			byte[] data = new byte[(i - runStart) * 2];
+			for (int j = runStart; j < i; j++) {
+				data[(j - runStart) * 2 + 0] = (byte)(words[j] >>> 0);
+				data[(j - runStart) * 2 + 1] = (byte)(words[j] >>> 8);
+			}
+
+			setWordAddress(rowAddress + runStart);
+			int maxBlockSize = programmer.getWriteBlockSize();
+			for (int j = 0; j < data.length; j += maxBlockSize) {
+				int blockSize = Math.min(data.length - j, maxBlockSize);
+				programmer.writeBlock(data, j, blockSize);
+			}
+		}
+	}
+	
+	private void setWordAddress(int address) {
+		// The programmer adds 8000h words
+		// per extended address.
+		programmer.setExtendedAddress(address >>> 15);
+		programmer.setAddress(address & 0x7FFF);
+	}
+	
+	@Override
+	protected void extendedAddress(int extendedAddress) {
+		this.extendedAddress = extendedAddress;
+	}
+	
+	@Override
+	protected void programData(int address, byte[] data, int offset, int numBytes) {
+		// Store the words by row
+		int byteAddress = (extendedAddress << 16) + address;
+		for (int i = 0; i < numBytes; i += 2) {
+			int wordAddress = (byteAddress + i) >>> 1;
+
+			int[] row = rows.get(wordAddress / rowSize);
+			if (row == null) {
+				row = new int[rowSize];
+				Arrays.fill(row, -1);
+				rows.put(wordAddress / rowSize, row);
+			}
+
+			int word = MemoryUtil.bytesToUnsignedShortSecure(data, offset + i, false);
+			row[wordAddress % rowSize] = word & ERASED_WORD;
+		}
+	}
+	
+	@Override
+	protected void endProcessing() {
+	}
+}
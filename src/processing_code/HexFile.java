@@ -1,10 +1,11 @@
+import java.io.ByteArrayOutputStream;
 import java.io.Reader;
 import java.io.IOException;
 
 import java.util.ArrayList;
-import java.util.Iterator;
 import java.util.List;
-import java.util.LinkedList;
+import java.util.Map;
+import java.util.TreeMap;
 
 public class HexFile {
 
@@ -15,111 +16,90 @@ public class HexFile {
 	public static final int DATA_TYPE = 0x00;
 	public static final int END_OF_FILE_TYPE = 0x01;
 	
-	public final List<HexFileEntry> entries;
+	/** The number of bytes per page of the image. A
+	  * multiple of the row size of all devices. */
+	public static final int PAGE_SIZE = 256;
+	/** The number of bytes addressed by a single
+	  * extended address. Spans never cross it. */
+	public static final int SEGMENT_SIZE = 0x10000;
+	
+	/** The pages of the image by page index (absolute
+	  * byte address divided by the page size). */
+	private final Map<Integer, HexPage> pages;
+	private int extendedAddress;
+	private boolean endOfFile;
+
 	public int numDataBytes;
 	public int parsedLines;
 	
 	public HexFile(Reader reader) throws IOException {
-		entries = new LinkedList<HexFileEntry>();
+		pages = new TreeMap<Integer, HexPage>();
 		readHexFile(reader);
-		packHexFile();
 	}
 
-	public void packHexFile() {
-		List<HexFileEntry> packedEntries = new LinkedList<HexFileEntry>();
-		// Used to temp store data-entries
-		List<HexFileEntry> dataEntries = new LinkedList<HexFileEntry>();
+	public List<HexSpan> getSpans() {
+		// Merge the bytes of the image into
+		// contiguous spans, sorted by address.
+		List<HexSpan> spans = new ArrayList<HexSpan>();
 
-		int address = -1;
-		int numDataBytes = 0;
-		
-		Iterator<HexFileEntry> iterator = entries.iterator();
-		while (iterator.hasNext()) {
-			// Count the number of bytes
-			// of data we have in a row.
-			HexFileEntry entry;
-			while ((entry = iterator.next()).recordType == DATA_TYPE) {
-				if (address == -1 || address == entry.address) {
-					// Add entry to temp data-row
-					dataEntries.add(entry);
-					numDataBytes += entry.numBytes;
-					// The address will be 
-					// incremented by one each
-					// time we have a byte.
-					address = entry.address + entry.numBytes;
-				} else {
-					// The two data-entries are
-					// not in line. The address
-					// of the last byte in the
-					// first entry does not match
-					// the address of the first
-					// byte in the second entry.
-					break;
-				}
-			}
+		ByteArrayOutputStream spanData = new ByteArrayOutputStream();
+		int spanAddress = 0;
+
+		for (Map.Entry<Integer, HexPage> pageEntry : pages.entrySet()) {
+			int pageAddress = pageEntry.getKey() * PAGE_SIZE;
+			HexPage page = pageEntry.getValue();
+
+			for (int i = 0; i < PAGE_SIZE; i++) {
+				if (!page.present[i])
+					continue;
 
-			// Pack the actual data in the
-			// row that was counted.
-			if (!dataEntries.isEmpty()) {
-				// Copy the data-entry data into
-				// a single array.
-				byte[] packedData;
-				if (dataEntries.size() > 1) {
-					// We have more than a single
-					// entry. We can't just reuse
-					// The same entry.
-					packedData = new byte[numDataBytes];
-					int bc = 0;
-					for (HexFileEntry dataEntry : dataEntries) {
-						System.arraycopy(dataEntry.data, 0, packedData, bc, dataEntry.numBytes);
-						bc += dataEntry.numBytes;
-					}
-					int addr = dataEntries.get(0).address;
-					packedEntries.add(new HexFileEntry(numDataBytes, addr, DATA_TYPE, packedData));
-				} else {
-					packedEntries.add(dataEntries.get(0));
+				// End the current span, if the byte
+				// doesn't continue it.
+				int address = pageAddress + i;
+				if (spanData.size() != 0 && (address != spanAddress + spanData.size() || address % SEGMENT_SIZE == 0)) {
+					spans.add(new HexSpan(spanAddress, spanData.toByteArray()));
+					spanData.reset();
 				}
 
-				// Invalidate temp data-row
-				dataEntries.clear();
-				numDataBytes = 0;
-				address = -1;
+				if (spanData.size() == 0)
+					spanAddress = address;
+				spanData.write(page.data[i]);
 			}
+		}
 
-			// Check out left-over entry
-			if (entry.recordType != DATA_TYPE) {
-				// We are working with a non-data
-				// entry. We can't pack it.
-				packedEntries.add(entry);
-				continue;
-			}
+		if (spanData.size() != 0)
+			spans.add(new HexSpan(spanAddress, spanData.toByteArray()));
 
-			// We have more data to pack
-			
-			// The data is the last entry
-			// in this hex-file. Reuse it.
-			if (!iterator.hasNext()) {
-				packedEntries.add(entry);
-				break;
+		return spans;
+	}
+
+	private void storeData(int address, byte[] data, int numBytes) {
+		// Later records overwrite earlier ones,
+		// like they would when programmed.
+		for (int i = 0; i < numBytes; i++) {
+			int byteAddress = address + i;
+
+			HexPage page = pages.get(byteAddress / PAGE_SIZE);
+			if (page == null) {
+				page = new HexPage();
+				pages.put(byteAddress / PAGE_SIZE, page);
 			}
 
-			// We have to pack more data
-			// which may be in a row. Add
-			// the entry to the temp list.
-			dataEntries.add(entry);
-			numDataBytes = entry.numBytes;
-			address = entry.address + entry.numBytes;
+			int pageOffset = byteAddress % PAGE_SIZE;
+			if (!page.present[pageOffset]) {
+				page.present[pageOffset] = true;
+				numDataBytes++;
+			}
+			page.data[pageOffset] = data[i];
 		}
-
-		// Replace all entries with
-		// the new ones.
-		entries.clear();
-		entries.addAll(packedEntries);
 	}
 	
 	public void readHexFile(Reader reader) throws IOException {
-		if (!entries.isEmpty())
-			entries.clear();
+		pages.clear();
+		extendedAddress = 0;
+		endOfFile = false;
+		numDataBytes = 0;
+
 		// We start at line 1
 		parsedLines = 1;
 		
@@ -129,7 +109,7 @@ public class HexFile {
 			switch((char)input) {
 			case HEX_ENTRY_CHARACTER:
 				wasNewline = false;
-				entries.add(readEntry(reader));
+				storeEntry(readEntry(reader));
 				break;
 			
 			case '\n':
@@ -147,6 +127,25 @@ public class HexFile {
 		}
 	}
 	
+	private void storeEntry(HexFileEntry entry) {
+		// Records after the end of file
+		// are ignored.
+		if (endOfFile)
+			return;
+
+		switch (entry.recordType) {
+		case EXTENDED_ADDRESS_TYPE:
+			extendedAddress = MemoryUtil.bytesToUnsignedShortSecure(entry.data, 0, true);
+			break;
+		case DATA_TYPE:
+			storeData((extendedAddress << 16) + entry.address, entry.data, entry.numBytes);
+			break;
+		case END_OF_FILE_TYPE:
+			endOfFile = true;
+			break;
+		}
+	}
+	
 	private HexFileEntry readEntry(Reader reader) throws IOException {
 		int numBytes = readByte(reader);
 		int addr0 = readByte(reader);
@@ -154,9 +153,6 @@ public class HexFile {
 		int address = (addr0 << 8) | addr1;
 		int recordType = readByte(reader);
 	
-		if (recordType == DATA_TYPE)
-			numDataBytes += numBytes;
-	
 		byte[] data = new byte[numBytes];
 		int i = 0;
 		while (i != numBytes)
@@ -187,4 +183,15 @@ public class HexFile {
 		
 		return (b0 << 4) | b1;
 	}
+
+	private static class HexPage {
+
+		public final byte[] data;
+		public final boolean[] present;
+
+		public HexPage() {
+			data = new byte[PAGE_SIZE];
+			present = new boolean[PAGE_SIZE];
+		}
+	}
 }
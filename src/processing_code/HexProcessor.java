@@ -1,10 +1,18 @@
 
 public abstract class HexProcessor {
 	
+	/** The minimum number of erased bytes in a row
+	  * to be skipped. Shorter runs cost more to seek
+	  * past than to send. */
+	public static final int MIN_ERASED_RUN = 16;
+	
 	protected final Programmer programmer;
 	protected final boolean twoBytesPerAddress;
 	protected final HexFile hex;
 	
+	/** The number of erased bytes skipped */
+	protected int skippedBytes;
+	
 	public HexProcessor(Programmer programmer, boolean twoBytesPerAddress, HexFile hex) {
 		this.programmer = programmer;
 		this.twoBytesPerAddress = twoBytesPerAddress;
@@ -12,24 +20,77 @@ public abstract class HexProcessor {
 	}
 	
 	public void processHexFile() {
-			program_loop: for (HexFileEntry entry : hex.entries) {
-				switch (entry.recordType) {
-				case HexFile.EXTENDED_ADDRESS_TYPE: // 0x04
-					extendedAddress(MemoryUtil.bytesToUnsignedShortSecure(entry.data, 0, true));
-					break;
-				case HexFile.DATA_TYPE: // 0x00
-					programData(entry.address, entry.data, entry.numBytes);
-					break;
-				case HexFile.END_OF_FILE_TYPE: // 0x01
-					endProcessing();
-					break program_loop;
-				}
+		// Spans are sorted by address, and don't
+		// cross the range of an extended address.
+		int extendedAddress = -1;
+		for (HexSpan span : hex.getSpans()) {
+			if ((span.address >>> 16) != extendedAddress) {
+				extendedAddress = span.address >>> 16;
+				extendedAddress(extendedAddress);
 			}
+
+			// Data memory is written a byte at a
+			// time, and isn't erased by the device.
+			// Every byte is programmed.
+			int dataAddress = programmer.getDataAddress();
+			if (dataAddress != -1 && span.address >= dataAddress) {
+				programData(span.address & 0xFFFF, span.data, 0, span.data.length);
+			} else {
+				processData(span.address & 0xFFFF, span.data, span.data.length);
+			}
+		}
+		endProcessing();
+	}
+	
+	protected void processData(int address, byte[] data, int numBytes) {
+		// Split the data into parts without
+		// runs of erased words. The offset is
+		// the start of the current part.
+		int offset = 0;
+
+		int i = 0;
+		while (i < numBytes) {
+			if (!isErasedWord(data, i)) {
+				i += 2;
+				continue;
+			}
+
+			int runEnd = i;
+			while (runEnd < numBytes && isErasedWord(data, runEnd))
+				runEnd += 2;
+			runEnd = Math.min(runEnd, numBytes);
+
+			// Runs at the start or end of a part
+			// don't need an extra seek.
+			if (i == offset || runEnd == numBytes || runEnd - i >= MIN_ERASED_RUN) {
+				if (i > offset)
+					programData(address + offset, data, offset, i - offset);
+				skippedBytes += runEnd - i;
+				offset = runEnd;
+			}
+
+			i = runEnd;
+		}
+
+		if (offset < numBytes)
+			programData(address + offset, data, offset, numBytes - offset);
+	}
+	
+	protected boolean isErasedWord(byte[] data, int offset) {
+		// Words are erased to 3FFFh (14-bit
+		// words) or FFh per byte.
+		if (twoBytesPerAddress)
+			return (MemoryUtil.bytesToUnsignedShortSecure(data, offset, false) & 0x3FFF) == 0x3FFF;
+		return MemoryUtil.getByteSecure(data, offset) == 0xFF && MemoryUtil.getByteSecure(data, offset + 1) == 0xFF;
+	}
+	
+	protected int getSkippedWords() {
+		return twoBytesPerAddress ? (skippedBytes >>> 1) : skippedBytes;
 	}
 	
 	protected abstract void extendedAddress(int extendedAddress);
 	
-	protected abstract void programData(int address, byte[] data, int numBytes);
+	protected abstract void programData(int address, byte[] data, int offset, int numBytes);
 	
 	protected abstract void endProcessing();
 }
@@ -1,6 +1,11 @@
 
 public class HexReadProcessor extends HexProcessor {
 	
+	/** The maximum number of bytes verified by a single
+	  * command. Reading them has to finish within the
+	  * receive timeout, even with the slowest pins. */
+	public static final int MAX_VERIFY_BYTES = 2048;
+	
 	public HexReadProcessor(Programmer programmer, boolean twoBytesPerAddress, HexFile hex) {
 		super(programmer, twoBytesPerAddress, hex);
 	}
@@ -20,26 +25,48 @@ public class HexReadProcessor extends HexProcessor {
 	}
 	
 	@Override
-	protected void programData(int address, byte[] data, int numBytes) {
+	protected void programData(int address, byte[] data, int offset, int numBytes) {
+		// Long spans are verified in chunks
+		int i = 0;
+		while (i < numBytes) {
+			int chunkSize = Math.min(numBytes - i, MAX_VERIFY_BYTES);
+			verifyData(address + i, data, offset + i, chunkSize);
+			i += chunkSize;
+		}
+	}
+	
+	private void verifyData(int address, byte[] data, int offset, int numBytes) {
 		// If we have 2 bytes per address,
 		// divide it by two.
 		if (twoBytesPerAddress)
 			address >>>= 1;
 		programmer.setAddress(address);
 		
+		// Let the programmer checksum the
+		// words. Only read them back if the
+		// checksum doesn't match.
+		int numWords = twoBytesPerAddress ? ((numBytes + 1) >>> 1) : numBytes;
+		if (programmer.checksumProgramWords(numWords) == calculateChecksum(data, offset, numBytes))
+			return;
+
+		// Read back the entire entry to
+		// find the mismatching word.
+		programmer.setAddress(address);
+		byte[] programmedWords = programmer.readProgramWords(numWords);
+
 		int incrementer = twoBytesPerAddress ? 2 : 1;
 		for (int i = 0; i < numBytes; i += incrementer) {
-			int programmedWord = programmer.readProgramWord();
+			int programmedWord = MemoryUtil.bytesToUnsignedShort(programmedWords, (i / incrementer) * 2, true);
 			
 			if (twoBytesPerAddress) {
-				int hexWord = MemoryUtil.bytesToUnsignedShortSecure(data, i, false);
+				int hexWord = MemoryUtil.bytesToUnsignedShortSecure(data, offset + i, false);
 				
 				if (programmedWord != hexWord)
 					throw new ProgrammingException("Program data: " + Integer.toHexString(programmedWord) + " at address " + 
 					                               Integer.toHexString(address + (i >>> 1)) + " does not match hex: " + Integer.toHexString(hexWord));
 			} else {
 				programmedWord &= 0xFF;
-				int hexWord = data[i] & 0xFF;
+				int hexWord = data[offset + i] & 0xFF;
 
 				if (programmedWord != hexWord)
 					throw new ProgrammingException("Program data: " + Integer.toHexString(programmedWord) + " at address " + 
@@ -47,11 +74,35 @@ public class HexReadProcessor extends HexProcessor {
 
 			}
 		}
+
+		// The words were transferred differently
+		// from how they were checksummed.
+		throw new ProgrammingException("Program checksum at address " + Integer.toHexString(address) + " does not match hex");
+	}
+	
+	private int calculateChecksum(byte[] data, int offset, int numBytes) {
+		// Checksum the hex words as they will
+		// be read from the programmer, MSB first.
+		int crc = 0xFFFF;
+		int incrementer = twoBytesPerAddress ? 2 : 1;
+		for (int i = 0; i < numBytes; i += incrementer) {
+			int hexWord;
+			if (twoBytesPerAddress) {
+				hexWord = MemoryUtil.bytesToUnsignedShortSecure(data, offset + i, false);
+			} else {
+				hexWord = data[offset + i] & 0xFF;
+			}
+			
+			crc = MemoryUtil.crc16(crc, hexWord >>> 8);
+			crc = MemoryUtil.crc16(crc, hexWord);
+		}
+		return crc;
 	}
 	
 	@Override
 	protected void endProcessing() {
 		// End of file, stop reading
+		System.out.println("Skipped verifying " + getSkippedWords() + " erased words");
 		System.out.println("Finished program verifying...");
 	}
 }
@@ -0,0 +1,17 @@
+
+public class HexSpan {
+	
+	/** The absolute byte address of the first byte */
+	public final int address;
+	public final byte[] data;
+	
+	public HexSpan(int address, byte[] data) {
+		this.address = address;
+		this.data = data;
+	}
+	
+	@Override
+	public String toString() {
+		return String.format("\n[%X, %d]", address, data.length);
+	}
+}
@@ -20,37 +20,32 @@ public class HexWriteProcessor extends HexProcessor {
 	}
 	
 	@Override
-	protected void programData(int address, byte[] data, int numBytes) {
+	protected void programData(int address, byte[] data, int offset, int numBytes) {
 		// If we have 2 bytes per address,
 		// divide it by two.
 		if (twoBytesPerAddress)
 			address >>>= 1;
 		programmer.setAddress(address);
 		
-		int writeBufferSize = 0;
-		for (int i = 0; i < numBytes; i++) {
-			// Load another byte into write-buffer.
-			programmer.loadWriteBuffer(data[i] & 0xFF);
-			writeBufferSize++;
-
-			// If we've filled up the write buffer
-			// we have to program the contents and
-			// empty it, so we can stream more data.
-			if (writeBufferSize >= Programmer.MAX_WRITE_BUFFER_SIZE) {
-				programmer.programWriteBuffer();
-				writeBufferSize = 0;
-			}
+		// Send the data in blocks that fit
+		// in the write buffer. Blocks are
+		// aligned to the block size, so they
+		// don't split rows of the device.
+		int byteAddress = twoBytesPerAddress ? (address << 1) : address;
+		int maxBlockSize = programmer.getWriteBlockSize();
+		int i = 0;
+		while (i < numBytes) {
+			int blockEnd = ((byteAddress + i) / maxBlockSize + 1) * maxBlockSize;
+			int blockSize = Math.min(numBytes - i, blockEnd - (byteAddress + i));
+			programmer.writeBlock(data, offset + i, blockSize);
+			i += blockSize;
 		}
-
-		// We have some left-over bytes
-		// to program in the write-buffer.
-		if (writeBufferSize > 0)
-			programmer.programWriteBuffer();
 	}
 	
 	@Override
 	protected void endProcessing() {
 		// End of file, stop programming
+		System.out.println("Skipped programming " + getSkippedWords() + " erased words");
 		System.out.println("Finished program writing...");
 	}
 }
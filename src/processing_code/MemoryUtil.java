@@ -24,6 +24,20 @@ public final class MemoryUtil {
 		return data[offset] & 0xFF;
 	}
 	
+	public static int crc16(int crc, int data) {
+		// CRC-16/CCITT (polynomial 1021h), same
+		// as calculated by the programmer.
+		crc ^= (data & 0xFF) << 8;
+		for (int i = 0; i < 8; i++) {
+			if ((crc & 0x8000) != 0) {
+				crc = (crc << 1) ^ 0x1021;
+			} else {
+				crc <<= 1;
+			}
+		}
+		return crc & 0xFFFF;
+	}
+	
 	public static int parseHexChar(char c) {
 		if (c >= '0' && c <= '9')
 			return (int)(c - '0');
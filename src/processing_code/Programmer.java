@@ -1,23 +1,209 @@
+import java.io.ByteArrayOutputStream;
+import java.util.ArrayDeque;
+import java.util.Arrays;
+import java.util.Queue;
+
+import jssc.SerialPortException;
 import processing.serial.Serial;
 
 public abstract class Programmer {
 
 	/** Command success response sent by the arduino */
 	public static final byte COMMAND_SUCCESS_DATA = (byte)'d';
-	/** The maximum number of bytes to be loaded into
-	  * the write buffer of the arduino programmer. */
-	public static final int MAX_WRITE_BUFFER_SIZE = 32;
+	/** The number of bytes to be loaded into the write
+	  * buffer, until the programmer reports its size. */
+	public static final int DEFAULT_WRITE_BUFFER_SIZE = 32;
+	/** The number of bytes sent ahead of the arduino,
+	  * until the programmer reports its receive buffer
+	  * size. The serial buffer (64 bytes) is always
+	  * kept as margin. */
+	public static final int DEFAULT_BYTES_IN_FLIGHT = 64;
+	/** The maximum time to wait for a response. The
+	  * slowest command (a bulk erase) takes ~10 ms. */
+	public static final long RECEIVE_TIMEOUT_MILLIS = 5000L;
+	/** Baudrates tried by negotiateBaudrate, fastest first */
+	public static final int[] NEGOTIATED_BAUDRATES = { 1000000, 500000, 250000 };
+	/** The time the arduino waits for a new baudrate
+	  * to be confirmed, before falling back. */
+	public static final long BAUDRATE_TIMEOUT_MILLIS = 200L;
+	/** Test pattern echoed by the arduino at a new baudrate */
+	private static final byte[] BAUDRATE_PATTERN = { 0x55, (byte)0xAA, 0x00, (byte)0xFF, 0x0F, 0x3C };
+	/** Sent when the echoed pattern was received */
+	private static final byte BAUDRATE_CONFIRM = (byte)'y';
+	/** The maximum number of bytes or units per token
+	  * of a run-length encoded block */
+	public static final int MAX_TOKEN_LENGTH = 128;
+	/** The minimum number of repeated units encoded as a
+	  * run. Shorter runs are cheaper as literals. */
+	public static final int MIN_RUN_LENGTH = 3;
+	/** Prefix of the machine-readable statistics lines */
+	public static final String STATISTICS_PREFIX = "stats";
+	/** Prefix of the firmware statistics lines */
+	public static final String FIRMWARE_STATISTICS_PREFIX = "fwstats";
+	/** Names of the counters sent by the arduino, in order */
+	public static final String[] FIRMWARE_STATISTICS = {
+		"commands", "icsp_bits", "delay_us", "bytes_in", "bytes_out", "wait_us", "skipped_words",
+		"programmer_bytes", "write_buffer_bytes", "receive_buffer_bytes"
+	};
 
 	private final Serial serialPort;
+	/** Notified whenever bytes are received */
+	private final Object receiveLock;
+
+	/** The baudrate of the serial port */
+	private int baudrate;
+	/** Send run-length encoded blocks, when smaller */
+	private boolean compressBlocks;
+
+	/** Buffer sizes reported by the programmer */
+	private int writeBufferSize;
+	private int receiveBufferSize;
+	/** The number of bytes programmed per row */
+	private int rowBytes;
+	/** The hex file address of the data memory
+	  * (EEPROM), -1 if the device has none. */
+	private int dataAddress;
+
+	/** The maximum number of commands in flight. A
+	  * window of one disables pipelining. */
+	private int pipelineWindow;
+	/** Commands sent, but not yet acknowledged */
+	private final Queue<PendingCommand> pendingCommands;
+	private int bytesInFlight;
+	/** The number of commands sent so far */
+	private long numCommands;
+
+	/** Transfer statistics of the current phase */
+	private String phase;
+	private long phaseStartTime;
+	private long bytesSent;
+	private long bytesReceived;
+	private long roundTrips;
 	
-	public Programmer(Serial serialPort) {
+	public Programmer(Serial serialPort, int baudrate) {
 		this.serialPort = serialPort;
+		this.baudrate = baudrate;
+		receiveLock = new Object();
+
+		writeBufferSize = DEFAULT_WRITE_BUFFER_SIZE;
+		receiveBufferSize = DEFAULT_BYTES_IN_FLIGHT;
+		rowBytes = 0;
+		dataAddress = -1;
+
+		pipelineWindow = 1;
+		pendingCommands = new ArrayDeque<PendingCommand>();
 	}
 	
 	public abstract void start();
 	
 	public abstract void stop();
 
+	public int negotiateBaudrate() {
+		// Try the fastest rates first, and keep
+		// the current one, if none of them work.
+		for (int newBaudrate : NEGOTIATED_BAUDRATES) {
+			if (newBaudrate == baudrate)
+				break;
+			if (tryBaudrate(newBaudrate))
+				break;
+		}
+
+		return baudrate;
+	}
+
+	public int getBaudrate() {
+		return baudrate;
+	}
+
+	private boolean tryBaudrate(int newBaudrate) {
+		byte command = (byte)'u';
+		drainPipeline();
+		write(new byte[] { command, (byte)(newBaudrate >>> 24), (byte)(newBaudrate >>> 16), 
+		                            (byte)(newBaudrate >>> 8), (byte)newBaudrate });
+		checkCommand(command);
+		try {
+			checkFeedback(command);
+		} catch (ProgrammingException e) {
+			// The baudrate is not supported
+			return false;
+		}
+
+		setBaudrate(newBaudrate);
+		try {
+			// The programmer echoes the pattern,
+			// and keeps the new rate if we confirm.
+			write(BAUDRATE_PATTERN);
+
+			byte[] echo = new byte[BAUDRATE_PATTERN.length];
+			waitForSerial(echo.length, BAUDRATE_TIMEOUT_MILLIS / 2);
+			receiveBytes(echo, 0, echo.length);
+
+			if (Arrays.equals(echo, BAUDRATE_PATTERN)) {
+				write(BAUDRATE_CONFIRM);
+
+				// The programmer falls back to the
+				// previous rate, if the confirmation
+				// is lost. Check the new rate by a
+				// round trip.
+				readFirmwareStatistics();
+				baudrate = newBaudrate;
+				return true;
+			}
+		} catch (ProgrammingException e) {
+			// The echo or the round trip timed out
+		}
+
+		// Wait for the programmer to fall back
+		// to the previous rate as well.
+		setBaudrate(baudrate);
+		try {
+			Thread.sleep(BAUDRATE_TIMEOUT_MILLIS * 2);
+		} catch (InterruptedException e) {
+		}
+		serialPort.clear();
+
+		return false;
+	}
+
+	protected void setBaudrate(int baudrate) {
+		// Change the rate of the open port.
+		// Reopening it would reset the arduino.
+		try {
+			serialPort.port.setParams(baudrate, 8, 1, 0);
+		} catch (SerialPortException e) {
+			throw new ProgrammingException("Unable to change baudrate to " + baudrate + ": " + e.getMessage());
+		}
+	}
+
+	protected int begin(byte mode) {
+		// The programmer responds with flags,
+		// its buffer sizes and its row size.
+		byte command = (byte)'b';
+		drainPipeline();
+		write(new byte[] { command, 0x00, mode });
+		checkCommand(command);
+
+		int flags = receiveBytes(2);
+		int writeBufferSize = receiveBytes(2);
+		int receiveBufferSize = receiveBytes(2);
+		int rowBytes = receiveBytes(2);
+		checkFeedback(command);
+
+		this.writeBufferSize = writeBufferSize;
+		this.receiveBufferSize = receiveBufferSize;
+		this.rowBytes = rowBytes;
+
+		return flags;
+	}
+
+	public int getWriteBlockSize() {
+		// Use whole rows, so every block is
+		// programmed in full row cycles.
+		if (rowBytes == 0 || rowBytes > writeBufferSize)
+			return writeBufferSize;
+		return writeBufferSize - writeBufferSize % rowBytes;
+	}
+
 	public void beginReading() {
 		doCommand((byte)'n');
 	}
@@ -26,6 +212,36 @@ public abstract class Programmer {
 		return doReadCommand((byte)'r', 2);
 	}
 	
+	public byte[] readProgramWords(int numWords) {
+		// Read a number of words in a single
+		// command. Each word is two bytes, MSB
+		// first, followed by a checksum byte.
+		byte[] frame = { (byte)'R', (byte)(numWords >>> 8), (byte)numWords };
+		drainPipeline();
+		write(frame);
+		checkCommand(frame[0]);
+
+		byte[] data = new byte[numWords * 2];
+		receiveBytes(data, 0, data.length);
+		byte checksum = (byte)receiveBytes(1);
+
+		// Consume the status, before checking
+		// the checksum. Otherwise it is left
+		// for the next command.
+		checkFeedback(frame[0]);
+
+		if (calculateChecksum(data, 0, data.length) != checksum)
+			throw new ProgrammingException("Invalid checksum of " + (char)frame[0] + " command");
+
+		return data;
+	}
+	
+	public int checksumProgramWords(int numWords) {
+		// The programmer reads the words and
+		// only sends back their CRC-16.
+		return doReadWriteCommand((byte)'c', 2, numWords);
+	}
+	
 	public void endReading() {
 		doCommand((byte)'m');
 	}
@@ -41,6 +257,43 @@ public abstract class Programmer {
 	public void programWriteBuffer() {
 		doCommand((byte)'p');
 	}
+
+	public void writeBlock(byte[] data, int offset, int numBytes) {
+		byte command = (byte)'w';
+		if (compressBlocks) {
+			byte[] encoded = encodeRunLength(data, offset, numBytes);
+			if (encoded.length < numBytes) {
+				command = (byte)'z';
+				data = encoded;
+				offset = 0;
+				numBytes = encoded.length;
+			}
+		}
+
+		// The block is framed by its length
+		// and a checksum byte, and programmed
+		// by a single command.
+		byte[] frame = new byte[numBytes + 4];
+		frame[0] = command;
+		frame[1] = (byte)(numBytes >>> 8);
+		frame[2] = (byte)numBytes;
+		System.arraycopy(data, offset, frame, 3, numBytes);
+		frame[numBytes + 3] = calculateChecksum(frame, 1, numBytes + 2);
+
+		sendCommand(frame);
+	}
+
+	public void setCompressBlocks(boolean compressBlocks) {
+		this.compressBlocks = compressBlocks;
+	}
+	
+	public void setDataAddress(int dataAddress) {
+		this.dataAddress = dataAddress;
+	}
+	
+	public int getDataAddress() {
+		return dataAddress;
+	}
 	
 	public void endWriting() {
 		doCommand((byte)'k');
@@ -62,10 +315,104 @@ public abstract class Programmer {
 		doCommand((byte)'e');
 	}
 
-	public void doCommand(byte command) {
-		serialPort.write(command);
+	public void eraseRow() {
+		doCommand((byte)'E');
+	}
+
+	public boolean[] readTargetResults(boolean primaryVerified) {
+		// The number of targets, followed by a
+		// bit per target, set if the target read
+		// differently from the primary target.
+		// The primary target (0) only passes if
+		// it was verified, and the gang targets
+		// only if they read the same as it.
+		byte command = (byte)'v';
+		drainPipeline();
+		write(command);
 		checkCommand(command);
+
+		int numTargets = receiveBytes(1);
+		int failedTargets = receiveBytes(1);
 		checkFeedback(command);
+
+		boolean[] passed = new boolean[numTargets];
+		for (int i = 0; i < numTargets; i++)
+			passed[i] = primaryVerified && (failedTargets & (1 << i)) == 0;
+
+		return passed;
+	}
+
+	public int readNumTargets() {
+		// Targets are counted by the same
+		// command, which reports them.
+		return readTargetResults(true).length;
+	}
+
+	public long[] readFirmwareStatistics() {
+		// The counters are sent as unsigned
+		// 32-bit integers, MSB first.
+		byte command = (byte)'q';
+		drainPipeline();
+		write(command);
+		checkCommand(command);
+
+		long[] counters = new long[FIRMWARE_STATISTICS.length];
+		for (int i = 0; i < counters.length; i++)
+			counters[i] = receiveBytes(4) & 0xFFFFFFFFL;
+		checkFeedback(command);
+
+		return counters;
+	}
+
+	public void printFirmwareStatistics() {
+		long[] counters = readFirmwareStatistics();
+
+		String header = FIRMWARE_STATISTICS_PREFIX;
+		String values = FIRMWARE_STATISTICS_PREFIX;
+		for (int i = 0; i < counters.length; i++) {
+			header += "," + FIRMWARE_STATISTICS[i];
+			values += "," + counters[i];
+		}
+		System.out.println(header);
+		System.out.println(values);
+	}
+
+	public static void printStatisticsHeader() {
+		System.out.println(STATISTICS_PREFIX + ",phase,millis,bytes_sent,bytes_received,round_trips");
+	}
+
+	public void beginPhase(String phase) {
+		this.phase = phase;
+
+		phaseStartTime = System.nanoTime();
+		bytesSent = 0;
+		bytesReceived = 0;
+		roundTrips = 0;
+	}
+
+	public void endPhase() {
+		// Include the commands still in flight
+		drainPipeline();
+
+		// Print a single line, which can be
+		// collected from the console output.
+		long millis = (System.nanoTime() - phaseStartTime) / 1000000L;
+		System.out.println(STATISTICS_PREFIX + "," + phase + "," + millis + "," + bytesSent + "," + bytesReceived + "," + roundTrips);
+	}
+
+	public void setPipelineWindow(int pipelineWindow) {
+		drainPipeline();
+
+		this.pipelineWindow = Math.max(pipelineWindow, 1);
+	}
+
+	public void drainPipeline() {
+		while (!pendingCommands.isEmpty())
+			receivePendingCommand();
+	}
+
+	public void doCommand(byte command) {
+		sendCommand(new byte[] { command });
 	}
 	
 	public void doWriteCommand(byte command, int data) {
@@ -73,15 +420,14 @@ public abstract class Programmer {
 	}
 	
 	public void doWriteCommand(byte command, byte data0, byte data1) {
-		serialPort.write(command);
-		serialPort.write(data1);
-		serialPort.write(data0);
-		checkCommand(command);
-		checkFeedback(command);
+		sendCommand(new byte[] { command, data1, data0 });
 	}
 	
 	public int doReadCommand(byte command, int numBytes) {
-		serialPort.write(command);
+		// The data is needed right away
+		drainPipeline();
+
+		write(command);
 		checkCommand(command);		
 		int data = receiveBytes(numBytes);
 		checkFeedback(command);
@@ -94,11 +440,13 @@ public abstract class Programmer {
 	}
 
 	public int doReadWriteCommand(byte command, int numBytes, byte data0, byte data1) {
-		serialPort.write(command);
+		drainPipeline();
+
+		write(command);
 		
 		// Write Data
-		serialPort.write(data1);
-		serialPort.write(data0);
+		write(data1);
+		write(data0);
 
 		// Wait for feedback from 
 		// specific command.
@@ -112,6 +460,115 @@ public abstract class Programmer {
 		return data;
 	}
 
+	protected void sendCommand(byte[] frame) {
+		numCommands++;
+
+		// Without pipelining, the status of
+		// the command is checked right away.
+		if (pipelineWindow == 1) {
+			write(frame);
+			checkCommand(frame[0]);
+			checkFeedback(frame[0]);
+			return;
+		}
+
+		// Wait for the oldest commands, until
+		// the new command fits in the window.
+		while (!pendingCommands.isEmpty() && (pendingCommands.size() >= pipelineWindow || 
+		       bytesInFlight + frame.length > receiveBufferSize)) {
+			receivePendingCommand();
+		}
+
+		write(frame);
+		pendingCommands.add(new PendingCommand(frame[0], frame.length, numCommands));
+		bytesInFlight += frame.length;
+	}
+
+	private void receivePendingCommand() {
+		PendingCommand pending = pendingCommands.remove();
+		bytesInFlight -= pending.numBytes;
+
+		checkCommand(pending.command);
+
+		waitForSerial(1);
+		roundTrips++;
+
+		int code = read();
+		if ((byte)code != COMMAND_SUCCESS_DATA) {
+			// The following commands were already
+			// sent. Skip their responses, to keep
+			// the serial in sync.
+			while (!pendingCommands.isEmpty()) {
+				PendingCommand skipped = pendingCommands.remove();
+				checkCommand(skipped.command);
+				receiveBytes(1);
+			}
+			bytesInFlight = 0;
+
+			throw new ProgrammingException("Failed " + (char)pending.command + " command (command #" + pending.index + 
+			                               "), received code: " + (char)code);
+		}
+	}
+
+	public static byte[] encodeRunLength(byte[] data, int offset, int numBytes) {
+		// Runs of a repeated two byte unit are
+		// encoded as 80h | (count - 1) followed
+		// by the unit. Everything else is sent
+		// as literals, (count - 1) followed by
+		// the bytes.
+		ByteArrayOutputStream encoded = new ByteArrayOutputStream();
+
+		int literalStart = 0;
+		int i = 0;
+		while (i < numBytes) {
+			int run = 0;
+			if (i + 1 < numBytes) {
+				run = 1;
+				while (run < MAX_TOKEN_LENGTH && i + (run + 1) * 2 <= numBytes && 
+				       data[offset + i + run * 2 + 0] == data[offset + i + 0] && 
+				       data[offset + i + run * 2 + 1] == data[offset + i + 1]) {
+					run++;
+				}
+			}
+
+			if (run < MIN_RUN_LENGTH) {
+				i++;
+				continue;
+			}
+
+			encodeLiterals(encoded, data, offset + literalStart, i - literalStart);
+			encoded.write(0x80 | (run - 1));
+			encoded.write(data[offset + i + 0]);
+			encoded.write(data[offset + i + 1]);
+
+			i += run * 2;
+			literalStart = i;
+		}
+		encodeLiterals(encoded, data, offset + literalStart, numBytes - literalStart);
+
+		return encoded.toByteArray();
+	}
+
+	private static void encodeLiterals(ByteArrayOutputStream encoded, byte[] data, int offset, int numBytes) {
+		while (numBytes > 0) {
+			int count = Math.min(numBytes, MAX_TOKEN_LENGTH);
+			encoded.write(count - 1);
+			encoded.write(data, offset, count);
+
+			offset += count;
+			numBytes -= count;
+		}
+	}
+
+	public static byte calculateChecksum(byte[] data, int offset, int numBytes) {
+		byte check = 0;
+		while (numBytes-- > 0)
+			check += data[offset++];
+
+		// Checksum is two's complement
+		return (byte)((byte)(~check) + 1);
+	}
+
 	public int receiveBytes(int numBytes) {
 		// Wait for our bytes of data
 		waitForSerial(numBytes);
@@ -119,16 +576,32 @@ public abstract class Programmer {
 		int data = 0;
 		while (numBytes-- != 0) {
 			data <<= 8;
-			data |= serialPort.read() & 0xFF;
+			data |= read() & 0xFF;
 		}
 
 		return data;
 	}
 	
+	public void receiveBytes(byte[] data, int offset, int numBytes) {
+		while (numBytes > 0) {
+			waitForSerial(1);
+
+			// Read everything available, without
+			// waiting for the entire response.
+			int available = Math.min(serialPort.available(), numBytes);
+			numBytes -= available;
+			while (available-- != 0)
+				data[offset++] = (byte)read();
+		}
+	}
+	
 	public void checkFeedback(byte command) {
 		waitForSerial(1);
 		
-		int code = serialPort.read();
+		// Every command ends with its status
+		roundTrips++;
+
+		int code = read();
 		if ((byte)code != COMMAND_SUCCESS_DATA)
 			throw new ProgrammingException("Failed " + (char)command + " command, received code: " + (char)code);
 	}
@@ -137,16 +610,67 @@ public abstract class Programmer {
 		while (true) {
 			waitForSerial(1);
 
-			if ((byte)serialPort.read() == command)
+			if ((byte)read() == command)
 				break;
 		}
 	}
 
+	protected void write(int data) {
+		serialPort.write(data);
+		bytesSent++;
+	}
+
+	protected void write(byte[] data) {
+		serialPort.write(data);
+		bytesSent += data.length;
+	}
+
+	protected int read() {
+		bytesReceived++;
+		return serialPort.read();
+	}
+
+	private static class PendingCommand {
+
+		public final byte command;
+		public final int numBytes;
+		public final long index;
+
+		public PendingCommand(byte command, int numBytes, long index) {
+			this.command = command;
+			this.numBytes = numBytes;
+			this.index = index;
+		}
+	}
+
+	public void serialEvent() {
+		// Called by the serial thread, when
+		// bytes have been received.
+		synchronized (receiveLock) {
+			receiveLock.notifyAll();
+		}
+	}
+
 	protected void waitForSerial(int numBytes) {
-		while(serialPort.available() < numBytes) {
-			try {
-				Thread.sleep(1);
-			} catch (InterruptedException e) {
+		waitForSerial(numBytes, RECEIVE_TIMEOUT_MILLIS);
+	}
+
+	protected void waitForSerial(int numBytes, long timeoutMillis) {
+		long deadline = System.currentTimeMillis() + timeoutMillis;
+
+		// The available bytes are checked while
+		// holding the lock, so a notification
+		// can't be missed.
+		synchronized (receiveLock) {
+			while (serialPort.available() < numBytes) {
+				long timeout = deadline - System.currentTimeMillis();
+				if (timeout <= 0L)
+					throw new ProgrammingException("Timed out waiting for " + numBytes + " bytes from programmer");
+
+				try {
+					receiveLock.wait(timeout);
+				} catch (InterruptedException e) {
+				}
 			}
 		}
 	}
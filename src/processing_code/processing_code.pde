@@ -13,9 +13,18 @@ private final String FILE_PATH = "C:/Users/Christian/MPLABXProjects/blink-pic16f
 private final int TARGET_DEVICE_ID = PIC16F18426_DEV_ID;
 /** Programming mode specification */
 private final boolean FORCE_LOW_VOLTAGE_PROGRAMMING = true;
+/** Only erase and reprogram rows which differ from the device */
+private final boolean DIFFERENTIAL_PROGRAMMING = false;
+
+/** The number of commands sent ahead of the programmer, 1 to disable */
+private static final int PIPELINE_WINDOW = 8;
 
 /** Serial communication baudrate */
 private static final int SERIAL_BAUDRATE = 115200;
+/** Switch to the fastest baudrate supported by the programmer */
+private static final boolean NEGOTIATE_BAUDRATE = true;
+/** Run-length encode blocks sent to the programmer, when smaller */
+private static final boolean COMPRESS_BLOCKS = true;
 
 /** Supported devices' information */
 private static final int PIC12F1822_DEV_ID  = 0x0138;
@@ -62,37 +71,83 @@ private static final int[] PROGRAMMING_MODES = {
   PIC16F184XX_SPECIFICATION  // PIC16F18426
 };
 
+// The number of words erased by a row
+// erase. Zero if row erases are not
+// supported by the programmer.
+private static final int[] ROW_ERASE_SIZES = {
+  16, // PIC12F1822
+  32, // PIC16F1705
+  0,  // PIC18F13K22
+  16, // PIC16F883
+  32  // PIC16F18426
+};
+
+// The word address of the configuration
+// memory (only used by row erases).
+private static final int[] CONFIG_ADDRESSES = {
+  0x8000, // PIC12F1822
+  0x8000, // PIC16F1705
+  0,      // PIC18F13K22
+  0x2000, // PIC16F883
+  0x8000  // PIC16F18426
+};
+
+// The hex file address of the data memory
+// (EEPROM), -1 if the device has none.
+private static final int[] DATA_ADDRESSES = {
+  0x1E000,  // PIC12F1822  (F000h)
+  -1,       // PIC16F1705
+  0xF00000, // PIC18F13K22
+  0x4200,   // PIC16F883   (2100h)
+  0x1E000   // PIC16F18426 (F000h)
+};
+
 private static final char POWER_GOOD_SIG = 'g';
 
 private static final int TWO_BYTES_PER_ADDRESS_FLAG = 0x01;
 
 private int targetDeviceIndex = -1;
 
+// The hex file, target device and serial
+// port can be given as arguments (--hex,
+// --device and --port), as done by the
+// host benchmark (test/host).
+private String hexPath = FILE_PATH;
+private int targetDeviceId = TARGET_DEVICE_ID;
+private String portName = null;
+
+/** The programmer waiting for serial data */
+private volatile Programmer activeProgrammer = null;
+
 void setup() {
   noLoop();
   
+  parseArguments();
+  
   for (int i = 0; i < SUPPORTED_DEVICE_IDS.length; i++) {
     int deviceId = SUPPORTED_DEVICE_IDS[i];
-    if (deviceId == TARGET_DEVICE_ID) {
+    if (deviceId == targetDeviceId) {
       targetDeviceIndex = i;
       break;
     }
   }
   
   if (targetDeviceIndex == -1) {
-    println("Target device doesn't exist: " + Integer.toHexString(TARGET_DEVICE_ID));
+    println("Target device doesn't exist: " + Integer.toHexString(targetDeviceId));
     return;
   }
   
   printArray(Serial.list());
   
-  Serial serialPort = new Serial(this, Serial.list()[1], SERIAL_BAUDRATE);
+  if (portName == null)
+    portName = Serial.list()[1];
+  Serial serialPort = new Serial(this, portName, SERIAL_BAUDRATE);
   
   Reader reader = null;
   HexFile hex = null;
   
   try {
-    reader = new FileReader(new File(FILE_PATH));
+    reader = new FileReader(new File(hexPath));
     hex = new HexFile(reader);
     println("Read and parsed hex file successfully (" + hex.parsedLines + " lines, " + hex.numDataBytes + " bytes).");
   } catch (IOException e) {
@@ -132,15 +187,69 @@ void setup() {
     }
     
     ProgrammerImpl programmer = new ProgrammerImpl(serialPort);
+    activeProgrammer = programmer;
     
     try {
+      if (NEGOTIATE_BAUDRATE) {
+        int baudrate = programmer.negotiateBaudrate();
+        println("Transfer baudrate: " + baudrate);
+      }
+
+      Programmer.printStatisticsHeader();
+
+      programmer.beginPhase("start");
       programmer.start();
+      programmer.endPhase();
+
+      programmer.setPipelineWindow(PIPELINE_WINDOW);
+      programmer.setCompressBlocks(COMPRESS_BLOCKS);
+      programmer.setDataAddress(DATA_ADDRESSES[targetDeviceIndex]);
+
+      // Differential programming only checks
+      // the rows of the primary target. Gang
+      // targets are programmed in full.
+      boolean differential = DIFFERENTIAL_PROGRAMMING;
+      if (differential && programmer.readNumTargets() > 1) {
+        println("Gang programming, programming entire device...");
+        differential = false;
+      }
 
-      println("Erasing program data...");
-      programmer.eraseDevice();
+      if (differential) {
+        int rowSize = ROW_ERASE_SIZES[targetDeviceIndex];
+        int configAddress = CONFIG_ADDRESSES[targetDeviceIndex];
+        programmer.beginPhase("diff");
+        new HexDiffProcessor(programmer, programmer.twoBytesPerAddress, hex, rowSize, configAddress).processHexFile();
+        programmer.endPhase();
+      } else {
+        println("Erasing program data...");
+        programmer.beginPhase("erase");
+        programmer.eraseDevice();
+        programmer.endPhase();
 
-      new HexWriteProcessor(programmer, programmer.twoBytesPerAddress, hex).processHexFile();
-      new HexReadProcessor(programmer, programmer.twoBytesPerAddress, hex).processHexFile();
+        programmer.beginPhase("write");
+        new HexWriteProcessor(programmer, programmer.twoBytesPerAddress, hex).processHexFile();
+        programmer.endPhase();
+      }
+      programmer.beginPhase("verify");
+      ProgrammingException verifyException = null;
+      try {
+        new HexReadProcessor(programmer, programmer.twoBytesPerAddress, hex).processHexFile();
+      } catch (ProgrammingException pe) {
+        verifyException = pe;
+      }
+      programmer.endPhase();
+
+      // The primary target has been verified
+      // above. Gang targets are compared to it,
+      // and reported even if it failed.
+      boolean[] targets = programmer.readTargetResults(verifyException == null);
+      for (int i = 0; i < targets.length; i++)
+        println("Target " + i + ": " + (targets[i] ? "pass" : "fail"));
+
+      if (verifyException != null)
+        throw verifyException;
+
+      programmer.printFirmwareStatistics();
       println("Done!");
     } catch (ProgrammingException pe) {
       pe.printStackTrace();
@@ -153,19 +262,50 @@ void setup() {
     }
   }
   
+  activeProgrammer = null;
+
   serialPort.clear();
   serialPort.stop();
   
   exit();
 }
 
+void parseArguments() {
+  if (args == null)
+    return;
+  
+  for (int i = 0; i + 1 < args.length; i += 2) {
+    if (args[i].equals("--hex")) {
+      hexPath = args[i + 1];
+    } else if (args[i].equals("--port")) {
+      portName = args[i + 1];
+    } else if (args[i].equals("--device")) {
+      // Unknown names are reported as a
+      // missing target device.
+      targetDeviceId = -1;
+      for (int j = 0; j < SUPPORTED_DEVICE_NAMES.length; j++) {
+        if (SUPPORTED_DEVICE_NAMES[j].equals(args[i + 1]))
+          targetDeviceId = SUPPORTED_DEVICE_IDS[j];
+      }
+    }
+  }
+}
+
+void serialEvent(Serial port) {
+  // Wake up the programmer, instead
+  // of letting it poll the serial.
+  Programmer programmer = activeProgrammer;
+  if (programmer != null)
+    programmer.serialEvent();
+}
+
 private class ProgrammerImpl extends Programmer {
 
   public int connectedDevice;
   public boolean twoBytesPerAddress;
   
   public ProgrammerImpl(Serial serialPort) {
-    super(serialPort);
+    super(serialPort, SERIAL_BAUDRATE);
     
     connectedDevice = -1;
   }
@@ -175,7 +315,7 @@ private class ProgrammerImpl extends Programmer {
     if (FORCE_LOW_VOLTAGE_PROGRAMMING)
       mode |= LOW_VOLTAGE_PROGRAMMING_MASK;
     
-    int flags = doReadWriteCommand((byte)'b', 2, mode, (byte)0x00);
+    int flags = begin(mode);
     twoBytesPerAddress = (flags & TWO_BYTES_PER_ADDRESS_FLAG) != 0;
     
     int dev_id = readDeviceId();
@@ -203,6 +343,7 @@ private class ProgrammerImpl extends Programmer {
   
   public void stop() {
     doCommand((byte)'s');
+    drainPipeline();
     connectedDevice = -1;
     
     println("Stopped programming");
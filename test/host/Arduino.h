@@ -0,0 +1,92 @@
+/*
+ * Host stub of the Arduino core, used to build the
+ * firmware for Linux. Pins are connected to simulated
+ * targets (sim_target.h), the serial port to a modelled
+ * UART (sim_serial.h), and every call advances a
+ * modelled clock by its approximate cost on a 16 MHz
+ * ATmega328P (sim_clock.h).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+// ------------------- DIGITAL PINS ------------------- //
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// ----------------------- TIME ----------------------- //
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// ---------------------- SERIAL ---------------------- //
+
+class HardwareSerial
+{
+
+public:
+	void begin(unsigned long baud);
+	void end();
+	void flush();
+
+	int available();
+	int read();
+	size_t write(uint8_t data);
+	size_t print(char data);
+};
+
+extern HardwareSerial Serial;
+
+// ------------------ PORT REGISTERS ------------------ //
+
+#ifdef __AVR_ATmega328P__
+#define RAMEND 0x8FF
+
+// A register of PORTD. Digital pins 0-7 are mapped
+// to the bits of the port, like on the ATmega328P.
+// Every access is forwarded to the simulated pins.
+class SimPortRegister
+{
+
+public:
+	enum Kind { PORT, DDR, PIN };
+
+	explicit SimPortRegister(Kind kind) : kind(kind) { }
+
+	operator uint8_t() const;
+	SimPortRegister &operator=(unsigned int value);
+	SimPortRegister &operator|=(unsigned int mask);
+	SimPortRegister &operator&=(unsigned int mask);
+
+private:
+	// The value, without advancing the clock
+	uint8_t peek() const;
+
+	const Kind kind;
+};
+
+extern SimPortRegister PORTD;
+extern SimPortRegister DDRD;
+extern SimPortRegister PIND;
+
+// Busy-waits a number of cpu cycles
+void __builtin_avr_delay_cycles(unsigned long cycles);
+#endif
@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# Compares the instructions of the read and write paths
+# of every programming specification, with 32-bit (long)
+# and 64-bit (long long) device addresses, and prints
+# them as CSV:
+#
+#   address,function,long,long_long
+#
+#   test/host/address_width.sh > address.csv
+#
+# There is no AVR toolchain in the host build. The
+# sources are compiled for i386 instead (-m32 -Os),
+# where long long takes two registers like it takes
+# eight instead of four on the AVR. Only the objects
+# are built, so no 32-bit libraries are needed.
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+CXX=${CXX:-g++}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+# The functions called per word, or per block
+FUNCTIONS='readProgramWord|commandReadIncrement|programWriteBuffer|commandIncrementAddress|commandLoadProgramDataIncrement|setAddress|setDeviceAddress|getConfigAddress'
+
+# Prints "function instructions" of an object
+count() {
+	objdump -d -C --no-show-raw-insn "$1" | awk '
+		/^[0-9a-f]+ <.*>:$/ {
+			name = $0
+			sub(/^[0-9a-f]+ </, "", name)
+			sub(/\(.*$/, "", name)
+			next
+		}
+		/^ +[0-9a-f]+:\t/ { n[name]++ }
+		END { for (name in n) print name, n[name] }
+	' | grep -E "::($FUNCTIONS) " || true
+}
+
+for width in long "long long"; do
+	for source in "$ROOT"/src/arduino_code/*_pic_programmer.cpp; do
+		object=$OUT/$(basename "$source" .cpp).o
+		"$CXX" -m32 -Os -ffreestanding -fno-exceptions -fno-rtti \
+			-D__AVR_ATmega328P__ "-DPIC_ADDRESS_TYPE=$width" \
+			-I"$ROOT/test/host" -I"$ROOT/src/arduino_code" \
+			-c "$source" -o "$object"
+		count "$object"
+	done | sort > "$OUT/$(echo "$width" | tr ' ' '_').txt"
+done
+
+echo "address,function,long,long_long"
+join "$OUT/long.txt" "$OUT/long_long.txt" | awk '{ printf "address,%s,%s,%s\n", $1, $2, $3 }'
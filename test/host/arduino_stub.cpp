@@ -0,0 +1,158 @@
+#include <Arduino.h>
+
+#include "./sim_clock.h"
+#include "./sim_pins.h"
+#include "./sim_serial.h"
+
+uint64_t SimClock::cycles = 0;
+uint64_t SimClock::categoryCycles[SIM_NUM_CATEGORIES] = { };
+void (*SimClock::listener)() = nullptr;
+
+HardwareSerial Serial;
+
+// ------------------- DIGITAL PINS ------------------- //
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	SimClock::advance(SIM_PIN_MODE_CYCLES, SIM_PIN);
+	SimPins::setMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	SimClock::advance(SIM_DIGITAL_WRITE_CYCLES, SIM_PIN);
+	SimPins::setLatch(pin, val ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pin)
+{
+	SimClock::advance(SIM_DIGITAL_READ_CYCLES, SIM_PIN);
+	return SimPins::getLevel(pin);
+}
+
+// ----------------------- TIME ----------------------- //
+
+unsigned long micros()
+{
+	SimClock::advance(SIM_MICROS_CYCLES, SIM_TIMER);
+	return SimClock::micros();
+}
+
+unsigned long millis()
+{
+	SimClock::advance(SIM_MILLIS_CYCLES, SIM_TIMER);
+	return SimClock::micros() / 1000;
+}
+
+void delay(unsigned long ms)
+{
+	SimClock::advance(SimClock::fromMicros(ms * 1000), SIM_DELAY);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	SimClock::advance(SimClock::fromMicros(us), SIM_DELAY);
+}
+
+// ---------------------- SERIAL ---------------------- //
+
+void HardwareSerial::begin(unsigned long baud)
+{
+	SimSerial::begin(baud);
+}
+
+void HardwareSerial::end()
+{
+	SimSerial::end();
+}
+
+void HardwareSerial::flush()
+{
+	SimSerial::flush();
+}
+
+int HardwareSerial::available()
+{
+	return SimSerial::available();
+}
+
+int HardwareSerial::read()
+{
+	return SimSerial::read();
+}
+
+size_t HardwareSerial::write(uint8_t data)
+{
+	SimSerial::write(data);
+	return 1;
+}
+
+size_t HardwareSerial::print(char data)
+{
+	SimSerial::write((uint8_t)data);
+	return 1;
+}
+
+// ------------------ PORT REGISTERS ------------------ //
+
+#ifdef __AVR_ATmega328P__
+SimPortRegister PORTD(SimPortRegister::PORT);
+SimPortRegister DDRD(SimPortRegister::DDR);
+SimPortRegister PIND(SimPortRegister::PIN);
+
+SimPortRegister::operator uint8_t() const
+{
+	SimClock::advance(SIM_PORT_READ_CYCLES, SIM_PIN);
+	return peek();
+}
+
+uint8_t SimPortRegister::peek() const
+{
+	uint8_t value = 0;
+	for (uint8_t pin = 0; pin < 8; pin++) {
+		uint8_t bit = 0;
+		if (kind == PORT) {
+			bit = SimPins::getLatch(pin);
+		} else if (kind == DDR) {
+			bit = SimPins::getMode(pin) == OUTPUT;
+		} else {
+			bit = SimPins::getLevel(pin);
+		}
+		value |= (bit ? 1 : 0) << pin;
+	}
+	return value;
+}
+
+SimPortRegister &SimPortRegister::operator=(unsigned int value)
+{
+	SimClock::advance(SIM_PORT_WRITE_CYCLES, SIM_PIN);
+
+	// The serial pins (0 and 1) are left alone,
+	// like the UART overrides them.
+	for (uint8_t pin = 2; pin < 8; pin++) {
+		uint8_t bit = (value >> pin) & 0x1;
+		if (kind == PORT) {
+			SimPins::setLatch(pin, bit);
+		} else if (kind == DDR) {
+			SimPins::setMode(pin, bit ? OUTPUT : INPUT);
+		}
+	}
+	return *this;
+}
+
+SimPortRegister &SimPortRegister::operator|=(unsigned int mask)
+{
+	// Costs a single write, like SBI
+	return *this = peek() | mask;
+}
+
+SimPortRegister &SimPortRegister::operator&=(unsigned int mask)
+{
+	return *this = peek() & mask;
+}
+
+void __builtin_avr_delay_cycles(unsigned long cycles)
+{
+	SimClock::advance(cycles, SIM_DELAY);
+}
+#endif
@@ -0,0 +1,81 @@
+#!/bin/sh
+#
+# Programs the blink test and the synthetic full-flash
+# image of every device with every variant of the host
+# build, and prints the statistics as CSV (see
+# pic_bench.cpp). Options after the build directory are
+# passed to pic_bench.
+#
+#   test/host/benchmark.sh _gate_build > bench.csv
+#
+# The numbers are measured with the C++ port of the
+# transmitter (transmitter.cpp), not processing_code
+# itself. protocol_sync.sh checks that both send the
+# same protocol, but timings of the Java side (serial
+# library, threads) aren't part of them.
+#
+# If PROCESSING_JAVA is set to processing-java, the
+# transmitter (processing_code) is run against the
+# emulated programmer (sim_pty) as well, and its stats
+# lines are printed prefixed by "java,device,image,".
+# This path isn't run by the tests, and hasn't been
+# verified without a Processing installation.
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+BUILD=${1:-$ROOT/_gate_build}
+shift || true
+HOST=$BUILD/test/host
+
+DEVICES="PIC12F1822 PIC16F1705 PIC18F13K22 PIC16F883 PIC16F18426"
+VARIANTS="digital port gang"
+
+# The images of a device
+images() {
+	dir=$(echo "$1" | tr 'A-Z' 'a-z')
+	echo "$ROOT/test/$dir/blink.hex $HOST/$dir/full.hex"
+}
+
+status=0
+headers=yes
+for variant in $VARIANTS; do
+	for device in $DEVICES; do
+		for hex in $(images "$device"); do
+			# The transmitter negotiates the
+			# baudrate by default.
+			output=$("$HOST/pic_bench_$variant" --device "$device" --hex "$hex" --negotiate "$@" 2>/dev/null) || status=1
+			if [ "$headers" = yes ]; then
+				echo "$output" | grep ',device,'
+				headers=no
+			fi
+			echo "$output" | grep -v ',device,'
+		done
+	done
+done
+
+if [ -n "$PROCESSING_JAVA" ]; then
+	for device in $DEVICES; do
+		for hex in $(images "$device"); do
+			image=$(basename "$hex" .hex)
+			fifo=$(mktemp -u)
+			mkfifo "$fifo"
+
+			"$HOST/sim_pty_port" "$device" > "$fifo" &
+			exec 3< "$fifo"
+			rm "$fifo"
+			read -r line <&3
+			port=${line#pty,}
+
+			"$PROCESSING_JAVA" --sketch="$ROOT/src/processing_code" --run \
+				--device "$device" --hex "$hex" --port "$port" |
+				grep -E '^(stats|fwstats|Target)' | sed "s/^/java,$device,$image,/"
+
+			cat <&3
+			exec 3<&-
+			wait $! || status=1
+		done
+	done
+fi
+
+exit $status
@@ -0,0 +1,167 @@
+/*
+ * Generates a synthetic image, which programs every
+ * word of the program memory (flash) of a device.
+ * The words are pseudo-random, with a run of a
+ * repeated word in every fourth row, like the tables
+ * and padding of a real program. The same device
+ * always gives the same image.
+ *
+ * With "eeprom", the image programs the first rows
+ * of the program memory and every byte of the data
+ * memory (EEPROM) instead.
+ *
+ * With "changed", a few words in three rows differ
+ * from the image, for differential programming.
+ * "changed-data" also changes a byte of the data
+ * memory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "./hex_image.h"
+
+struct GeneratedDevice
+{
+	const char *name;
+	// Words of program memory, and the bits
+	// of a word.
+	unsigned int programWords;
+	unsigned int wordMask;
+	bool twoBytesPerAddress;
+	// Hex address and bytes of the data memory
+	long dataAddress;
+	unsigned int dataBytes;
+};
+
+static const GeneratedDevice DEVICES[] = {
+	{ "PIC12F1822",  2048,  0x3FFF, true,  0x1E000,  256 },
+	{ "PIC16F1705",  8192,  0x3FFF, true,  -1,       0   },
+	{ "PIC18F13K22", 8192,  0xFF,   false, 0xF00000, 256 },
+	{ "PIC16F883",   4096,  0x3FFF, true,  0x4200,   256 },
+	{ "PIC16F18426", 16384, 0x3FFF, true,  0x1E000,  256 }
+};
+
+// Words of a row, and the rows between runs
+#define GENERATED_ROW_WORDS 32
+#define GENERATED_RUN_ROWS  4
+// Rows of program memory in an EEPROM image
+#define GENERATED_EEPROM_ROWS 2
+
+// The words changed by "changed", in rows of 16
+// and 32 words. Words outside of the image are
+// left out.
+static const unsigned int CHANGED_WORDS[] = { 35, 177, 192, 193 };
+#define CHANGED_DATA_BYTE 5
+
+// Flips bits, which are set and cleared, so the
+// row has to be erased. Never gives an erased word.
+static unsigned int changeWord(unsigned int word, unsigned int wordMask)
+{
+	word ^= 0x0101 & wordMask;
+	if (word == wordMask)
+		word ^= 0x2;
+	return word;
+}
+
+int main(int argc, char **argv)
+{
+	bool valid = argc >= 3;
+	bool eeprom = false;
+	bool changed = false;
+	bool changedData = false;
+	for (int i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "eeprom") == 0) {
+			eeprom = true;
+		} else if (strcmp(argv[i], "changed") == 0) {
+			changed = true;
+		} else if (strcmp(argv[i], "changed-data") == 0) {
+			changed = true;
+			changedData = true;
+		} else {
+			valid = false;
+		}
+	}
+	if (!valid) {
+		fprintf(stderr, "usage: gen_hex DEVICE FILE [eeprom] [changed | changed-data]\n");
+		return 2;
+	}
+
+	const GeneratedDevice *device = nullptr;
+	for (const GeneratedDevice &candidate : DEVICES) {
+		if (strcmp(candidate.name, argv[1]) == 0)
+			device = &candidate;
+	}
+	if (device == nullptr) {
+		fprintf(stderr, "Unknown device: %s\n", argv[1]);
+		return 2;
+	}
+	if ((eeprom || changedData) && device->dataBytes == 0) {
+		fprintf(stderr, "No data memory: %s\n", argv[1]);
+		return 2;
+	}
+
+	HexImage hex;
+	uint32_t seed = 0x2F6E2B1;
+	for (const char *c = device->name; *c != '\0'; c++)
+		seed = seed * 31 + *c;
+
+	unsigned int programWords = device->programWords;
+	if (eeprom)
+		programWords = GENERATED_EEPROM_ROWS * GENERATED_ROW_WORDS;
+
+	unsigned int word = 0;
+	for (unsigned int i = 0; i < programWords; i++) {
+		bool run = (i / GENERATED_ROW_WORDS) % GENERATED_RUN_ROWS == GENERATED_RUN_ROWS - 1;
+		if (!run || i % GENERATED_ROW_WORDS == 0) {
+			// Numerical Recipes LCG
+			seed = seed * 1664525 + 1013904223;
+			word = (seed >> 8) & device->wordMask;
+		}
+
+		// Erased words would be skipped
+		if (word == device->wordMask)
+			word ^= 0x1;
+
+		unsigned int programmed = word;
+		for (unsigned int changedWord : CHANGED_WORDS) {
+			if (changed && i == changedWord)
+				programmed = changeWord(word, device->wordMask);
+		}
+
+		if (device->twoBytesPerAddress) {
+			hex.bytes[i * 2 + 0] = programmed;
+			hex.bytes[i * 2 + 1] = programmed >> 8;
+		} else {
+			hex.bytes[i] = programmed;
+		}
+	}
+
+	// Every byte of the data memory. Devices with
+	// two bytes per address store a byte per word.
+	for (unsigned int i = 0; eeprom && i < device->dataBytes; i++) {
+		seed = seed * 1664525 + 1013904223;
+		uint8_t data = seed >> 16;
+		if (data == 0xFF)
+			data ^= 0x1;
+		if (changedData && i == CHANGED_DATA_BYTE)
+			data = changeWord(data, 0xFF);
+
+		if (device->twoBytesPerAddress) {
+			hex.bytes[device->dataAddress + i * 2 + 0] = data;
+			hex.bytes[device->dataAddress + i * 2 + 1] = 0x00;
+		} else {
+			hex.bytes[device->dataAddress + i] = data;
+		}
+	}
+
+	if (!hex.write(argv[2])) {
+		fprintf(stderr, "Unable to write hex file: %s\n", argv[2]);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+#include "./hex_image.h"
+
+#include <algorithm>
+#include <fstream>
+
+// Hex file record types
+#define DATA_TYPE             0x00
+#define END_OF_FILE_TYPE      0x01
+#define EXTENDED_ADDRESS_TYPE 0x04
+
+static int parseHexByte(const std::string &line, size_t offset)
+{
+	if (offset + 2 > line.size())
+		return -1;
+
+	int value = 0;
+	for (size_t i = offset; i < offset + 2; i++) {
+		char c = line[i];
+		value <<= 4;
+		if (c >= '0' && c <= '9') {
+			value |= c - '0';
+		} else if (c >= 'A' && c <= 'F') {
+			value |= c - 'A' + 10;
+		} else if (c >= 'a' && c <= 'f') {
+			value |= c - 'a' + 10;
+		} else {
+			return -1;
+		}
+	}
+	return value;
+}
+
+bool HexImage::read(const std::string &path)
+{
+	std::ifstream file(path.c_str());
+	if (!file)
+		return false;
+
+	bytes.clear();
+	uint32_t extendedAddress = 0;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t start = line.find(':');
+		if (start == std::string::npos)
+			continue;
+
+		// Every byte of the record, including
+		// the checksum, sums to zero.
+		std::vector<uint8_t> record;
+		for (size_t i = start + 1; i + 1 < line.size(); i += 2) {
+			int value = parseHexByte(line, i);
+			if (value < 0)
+				break;
+			record.push_back(value);
+		}
+		if (record.size() < 5 || record.size() != (size_t)record[0] + 5)
+			return false;
+
+		uint8_t checksum = 0;
+		for (uint8_t value : record)
+			checksum += value;
+		if (checksum != 0)
+			return false;
+
+		uint32_t address = (record[1] << 8) | record[2];
+		switch (record[3]) {
+		case DATA_TYPE:
+			// Later records overwrite earlier ones
+			for (unsigned int i = 0; i < record[0]; i++)
+				bytes[(extendedAddress << 16) + address + i] = record[4 + i];
+			break;
+		case EXTENDED_ADDRESS_TYPE:
+			extendedAddress = (record[4] << 8) | record[5];
+			break;
+		case END_OF_FILE_TYPE:
+			return true;
+		}
+	}
+
+	return true;
+}
+
+std::vector<HexSpan> HexImage::getSpans() const
+{
+	std::vector<HexSpan> spans;
+
+	for (const std::pair<const uint32_t, uint8_t> &byte : bytes) {
+		// Start a new span, if the byte doesn't
+		// continue the current one.
+		if (spans.empty() || byte.first % HEX_SEGMENT_SIZE == 0 ||
+		    byte.first != spans.back().address + spans.back().data.size()) {
+			spans.push_back(HexSpan());
+			spans.back().address = byte.first;
+		}
+		spans.back().data.push_back(byte.second);
+	}
+
+	return spans;
+}
+
+static void writeRecord(std::ofstream &file, uint8_t type, uint16_t address, const std::vector<uint8_t> &data)
+{
+	std::vector<uint8_t> record;
+	record.push_back(data.size());
+	record.push_back(address >> 8);
+	record.push_back(address);
+	record.push_back(type);
+	record.insert(record.end(), data.begin(), data.end());
+
+	uint8_t checksum = 0;
+	for (uint8_t value : record)
+		checksum += value;
+	record.push_back(-checksum);
+
+	static const char DIGITS[] = "0123456789ABCDEF";
+	file << ':';
+	for (uint8_t value : record)
+		file << DIGITS[value >> 4] << DIGITS[value & 0xF];
+	file << '\n';
+}
+
+bool HexImage::write(const std::string &path) const
+{
+	std::ofstream file(path.c_str());
+	if (!file)
+		return false;
+
+	// Records don't cross the range of an
+	// extended address.
+	long extendedAddress = -1;
+	for (const HexSpan &span : getSpans()) {
+		for (size_t i = 0; i < span.data.size(); i += 16) {
+			uint32_t address = span.address + i;
+			if ((long)(address >> 16) != extendedAddress) {
+				extendedAddress = address >> 16;
+				writeRecord(file, EXTENDED_ADDRESS_TYPE, 0, { (uint8_t)(extendedAddress >> 8), (uint8_t)extendedAddress });
+			}
+
+			size_t end = std::min(span.data.size(), i + 16);
+			writeRecord(file, DATA_TYPE, address, std::vector<uint8_t>(span.data.begin() + i, span.data.begin() + end));
+		}
+	}
+	writeRecord(file, END_OF_FILE_TYPE, 0, std::vector<uint8_t>());
+
+	return (bool)file;
+}
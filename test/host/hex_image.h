@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// The number of bytes addressed by a single
+// extended address. Spans never cross it.
+#define HEX_SEGMENT_SIZE 0x10000
+
+// A contiguous run of bytes of the image
+struct HexSpan
+{
+	uint32_t address;
+	std::vector<uint8_t> data;
+};
+
+// ------------------- HEX IMAGE ---------------------- //
+
+// An Intel hex file, read the same way as HexFile
+// of the transmitter.
+class HexImage
+{
+
+public:
+	// The bytes of the image by absolute address
+	std::map<uint32_t, uint8_t> bytes;
+
+	// Returns false, if the file can't be read
+	// or is malformed.
+	bool read(const std::string &path);
+	// Writes the image as data records of 16
+	// bytes. Returns false, if it can't be
+	// written.
+	bool write(const std::string &path) const;
+
+	// Contiguous spans, sorted by address
+	std::vector<HexSpan> getSpans() const;
+};
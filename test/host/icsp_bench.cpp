@@ -0,0 +1,190 @@
+/*
+ * Benchmark of the ICSP bit engine (PicSerial). Every
+ * specification programs and reads back a block of
+ * words on a simulated target, directly through its
+ * PicProgrammer, and the clock edges and modelled
+ * cycles per word are printed as CSV lines:
+ *
+ *   icsp,spec,backend,operation,words,edges_per_word,...
+ *
+ * The ICSP cycles exclude the delays of the
+ * specification (programming, erase, TDLY), which
+ * don't depend on the bit engine. Exits with a
+ * non-zero status if the words don't read back, or
+ * the timing of the specification is violated.
+ */
+
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include <constants.h>
+#include <PIC12F1822_pic_programmer.h>
+#include <PIC16F184XX_pic_programmer.h>
+#include <PIC16F88X_pic_programmer.h>
+#include <PIC18F1XK22_pic_programmer.h>
+
+#include "./sim_clock.h"
+#include "./sim_pic12f1822.h"
+#include "./sim_pic16f184xx.h"
+#include "./sim_pic18f1xk22.h"
+#include "./sim_pins.h"
+
+// The name of the firmware variant
+#ifndef SIM_BACKEND
+#define SIM_BACKEND "digital"
+#endif
+
+// The number of words programmed and read
+#define BENCH_WORDS 256
+
+struct BenchSpec
+{
+	const char *name;
+	uint8_t mode;
+	bool twoBytesPerAddress;
+};
+
+static const BenchSpec SPECS[] = {
+	{ "PIC12F1822",  PIC12F1822_SPECIFICATION,  true  },
+	{ "PIC18F1XK22", PIC18F1XK22_SPECIFICATION, false },
+	{ "PIC16F88X",   PIC16F88X_SPECIFICATION,   true  },
+	{ "PIC16F184XX", PIC16F184XX_SPECIFICATION, true  }
+};
+
+// The counters at the start of an operation
+struct BenchSample
+{
+	uint64_t cycles;
+	uint64_t clockEdges;
+	unsigned long delayedMicros;
+
+	static BenchSample take()
+	{
+		BenchSample sample = { SimClock::cycles, SimPins::clockEdges, PicTiming::delayedMicros };
+		return sample;
+	}
+};
+
+static SimTarget *createTarget(const BenchSpec &spec)
+{
+	switch (spec.mode) {
+	case PIC12F1822_SPECIFICATION:
+		return new SimPIC12F1822(SIM_PIC12F1822, ICSPDAT);
+	case PIC18F1XK22_SPECIFICATION:
+		return new SimPIC18F1XK22(SIM_PIC18F13K22, ICSPDAT);
+	case PIC16F88X_SPECIFICATION:
+		return new SimPIC12F1822(SIM_PIC16F883, ICSPDAT);
+	default:
+		return new SimPIC16F184XX(SIM_PIC16F18426, ICSPDAT);
+	}
+}
+
+static PicProgrammer *createProgrammer(const BenchSpec &spec)
+{
+	unsigned int mode = spec.mode | LOW_VOLTAGE_PROGRAMMING_MASK;
+	switch (spec.mode) {
+	case PIC12F1822_SPECIFICATION:
+		return new PIC12F1822_PicProgrammer(mode);
+	case PIC18F1XK22_SPECIFICATION:
+		return new PIC18F1XK22_PicProgrammer(mode);
+	case PIC16F88X_SPECIFICATION:
+		return new PIC16F88X_PicProgrammer(mode);
+	default:
+		return new PIC16F184XX_PicProgrammer(mode);
+	}
+}
+
+static void printOperation(const BenchSpec &spec, const char *operation, unsigned int numWords,
+                           const BenchSample &start)
+{
+	BenchSample end = BenchSample::take();
+
+	double cycles = (double)(end.cycles - start.cycles);
+	double icspCycles = cycles - SimClock::fromMicros(end.delayedMicros - start.delayedMicros);
+	printf("icsp,%s,%s,%s,%u,%.1f,%.1f,%.1f\n", spec.name, SIM_BACKEND, operation, numWords,
+	       (double)(end.clockEdges - start.clockEdges) / numWords, cycles / numWords, icspCycles / numWords);
+}
+
+static bool runSpec(const BenchSpec &spec)
+{
+	std::unique_ptr<SimTarget> target(createTarget(spec));
+	SimPins::attach(target.get());
+
+	// Same as the 'b' command of the sketch
+	pinMode(PVCC,    OUTPUT);
+	pinMode(ICSPCLK, OUTPUT);
+	pinMode(PGM,     OUTPUT);
+	digitalWrite(PVCC,    LOW);
+	digitalWrite(ICSPCLK, LOW);
+	digitalWrite(PGM,     LOW);
+	PicSerial::writeMode();
+
+	std::unique_ptr<PicProgrammer> programmer(createProgrammer(spec));
+	bool success = programmer->enterProgrammingMode();
+
+	// A word of 14-bit cores, or a byte
+	unsigned int wordBytes = spec.twoBytesPerAddress ? 2 : 1;
+	std::vector<unsigned char> words(BENCH_WORDS * wordBytes);
+	for (unsigned int i = 0; i < words.size(); i++)
+		words[i] = spec.twoBytesPerAddress && (i & 0x1) ? (i * 7) & 0x3F : i * 13;
+
+	programmer->eraseDevice();
+
+	BenchSample start = BenchSample::take();
+	programmer->beginWriting();
+	programmer->setExtendedAddress(0);
+	programmer->setAddress(0);
+	for (unsigned int i = 0; i < words.size(); i += WRITE_BUFFER_SIZE) {
+		unsigned int numBytes = words.size() - i < WRITE_BUFFER_SIZE ? words.size() - i : WRITE_BUFFER_SIZE;
+		programmer->programWriteBuffer(&words[i], numBytes);
+	}
+	programmer->endWriting();
+	printOperation(spec, "write", BENCH_WORDS, start);
+
+	start = BenchSample::take();
+	programmer->beginReading();
+	programmer->setAddress(0);
+	for (unsigned int i = 0; i < BENCH_WORDS; i++) {
+		unsigned int expected = words[i * wordBytes];
+		if (spec.twoBytesPerAddress)
+			expected |= words[i * wordBytes + 1] << 8;
+
+		unsigned int word = programmer->readProgramWord();
+		if (!spec.twoBytesPerAddress)
+			word &= 0xFF;
+		if (word != expected) {
+			if (success)
+				fprintf(stderr, "%s: %x at %x does not match %x\n", spec.name, word, i, expected);
+			success = false;
+		}
+	}
+	programmer->endReading();
+	printOperation(spec, "read", BENCH_WORDS, start);
+
+	programmer->leaveProgrammingMode();
+	pinMode(MCLR,    INPUT);
+	pinMode(PVCC,    INPUT);
+	pinMode(ICSPCLK, INPUT);
+	pinMode(PGM,     INPUT);
+	PicSerial::readMode();
+
+	for (const std::string &violation : target->violations)
+		fprintf(stderr, "%s: %s\n", spec.name, violation.c_str());
+	success &= target->numViolations == 0;
+
+	SimPins::detachAll();
+	return success;
+}
+
+int main()
+{
+	printf("icsp,spec,backend,operation,words,edges_per_word,cycles_per_word,icsp_cycles_per_word\n");
+
+	bool success = true;
+	for (const BenchSpec &spec : SPECS)
+		success &= runSpec(spec);
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,458 @@
+/*
+ * Programs a hex file into simulated targets through the
+ * firmware, the same way as the transmitter does, and
+ * prints the statistics of every phase as CSV lines:
+ *
+ *   bench,device,image,backend,phase,micros,...
+ *   fwstats,device,image,backend,...
+ *   result,device,image,backend,target,...,status
+ *
+ * With --diff, the original image is programmed first,
+ * and the hex file is programmed over it by changed
+ * rows (HexDiffProcessor). The rows erased and written
+ * by every target are compared with the rows, which
+ * differ between the images:
+ *
+ *   diff,device,image,backend,target,...,status
+ *
+ * The memory of every target is compared with the hex
+ * file afterwards. Exits with a non-zero status if the
+ * session fails, a target is programmed incorrectly or
+ * the timing of the specification is violated.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <constants.h>
+
+#include "./hex_image.h"
+#include "./sim_clock.h"
+#include "./sim_host.h"
+#include "./sim_pic12f1822.h"
+#include "./sim_pic16f184xx.h"
+#include "./sim_pic18f1xk22.h"
+#include "./sim_pins.h"
+#include "./sim_serial.h"
+#include "./transmitter.h"
+
+// The name of the firmware variant
+#ifndef SIM_BACKEND
+#define SIM_BACKEND "digital"
+#endif
+
+// Same as the transmitter (processing_code.pde)
+struct BenchDevice
+{
+	const char *name;
+	int deviceId;
+	uint8_t mode;
+	long dataAddress;
+	// Words of a row erase, zero if not supported,
+	// and the word address of the configuration.
+	unsigned int rowSize;
+	uint32_t configAddress;
+};
+
+static const BenchDevice DEVICES[] = {
+	{ "PIC12F1822",  0x0138, PIC12F1822_SPECIFICATION,  0x1E000,  16, 0x8000 },
+	{ "PIC16F1705",  0x0182, PIC12F1822_SPECIFICATION,  -1,       32, 0x8000 },
+	{ "PIC18F13K22", 0x027A, PIC18F1XK22_SPECIFICATION, 0xF00000, 0,  0      },
+	{ "PIC16F883",   0x0101, PIC16F88X_SPECIFICATION,   0x4200,   16, 0x2000 },
+	{ "PIC16F18426", 0x30D2, PIC16F184XX_SPECIFICATION, 0x1E000,  32, 0x8000 }
+};
+
+struct BenchFault
+{
+	unsigned int target;
+	uint32_t address;
+	unsigned int mask;
+};
+
+struct BenchOptions
+{
+	const char *device;
+	const char *hexPath;
+	// The name of the image in the statistics
+	std::string image;
+	unsigned long baudrate;
+	bool negotiate;
+	unsigned int pipelineWindow;
+	bool compress;
+	bool highVoltage;
+	unsigned long latencyMicros;
+	// The bytes, which have to be in flight at
+	// some point, for the blocks to overlap.
+	unsigned int minBytesInFlight;
+	// The first baudrate confirmation is lost
+	bool loseConfirm;
+	// The image programmed before the hex file
+	// is programmed by changed rows, and if the
+	// entire device has to be programmed instead.
+	const char *diffPath;
+	bool expectFull;
+	// Bits of a word of a target, which read
+	// back as zero.
+	std::vector<BenchFault> faults;
+};
+
+static SimTarget *createTarget(const std::string &device, uint8_t dataPin)
+{
+	if (device == "PIC12F1822")
+		return new SimPIC12F1822(SIM_PIC12F1822, dataPin);
+	if (device == "PIC16F1705")
+		return new SimPIC12F1822(SIM_PIC16F1705, dataPin);
+	if (device == "PIC16F883")
+		return new SimPIC12F1822(SIM_PIC16F883, dataPin);
+	if (device == "PIC16F18426")
+		return new SimPIC16F184XX(SIM_PIC16F18426, dataPin);
+	if (device == "PIC18F13K22")
+		return new SimPIC18F1XK22(SIM_PIC18F13K22, dataPin);
+	return nullptr;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+	        "usage: pic_bench --device NAME --hex FILE [--baud N] [--negotiate]\n"
+	        "                 [--window N] [--no-compress] [--high-voltage]\n"
+	        "                 [--latency-us N] [--fault ADDRESS:MASK[:TARGET]]\n"
+	        "                 [--image NAME] [--min-in-flight N] [--lose-confirm]\n"
+	        "                 [--diff ORIGINAL [--expect-full]]\n");
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+	options.device = nullptr;
+	options.hexPath = nullptr;
+	options.baudrate = TRANSFER_BAUDRATE;
+	options.negotiate = false;
+	options.pipelineWindow = 8;
+	options.compress = true;
+	options.highVoltage = false;
+	options.latencyMicros = 1000;
+	options.minBytesInFlight = 0;
+	options.loseConfirm = false;
+	options.diffPath = nullptr;
+	options.expectFull = false;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--device" && hasValue) {
+			options.device = argv[++i];
+		} else if (arg == "--hex" && hasValue) {
+			options.hexPath = argv[++i];
+		} else if (arg == "--image" && hasValue) {
+			options.image = argv[++i];
+		} else if (arg == "--baud" && hasValue) {
+			options.baudrate = strtoul(argv[++i], nullptr, 0);
+		} else if (arg == "--window" && hasValue) {
+			options.pipelineWindow = strtoul(argv[++i], nullptr, 0);
+		} else if (arg == "--latency-us" && hasValue) {
+			options.latencyMicros = strtoul(argv[++i], nullptr, 0);
+		} else if (arg == "--min-in-flight" && hasValue) {
+			options.minBytesInFlight = strtoul(argv[++i], nullptr, 0);
+		} else if (arg == "--diff" && hasValue) {
+			options.diffPath = argv[++i];
+		} else if (arg == "--fault" && hasValue) {
+			BenchFault fault = { 0, 0, 0 };
+			if (sscanf(argv[++i], "%x:%x:%u", &fault.address, &fault.mask, &fault.target) < 2)
+				return false;
+			options.faults.push_back(fault);
+		} else if (arg == "--negotiate") {
+			options.negotiate = true;
+		} else if (arg == "--lose-confirm") {
+			options.loseConfirm = true;
+		} else if (arg == "--expect-full") {
+			options.expectFull = true;
+		} else if (arg == "--no-compress") {
+			options.compress = false;
+		} else if (arg == "--high-voltage") {
+			options.highVoltage = true;
+		} else {
+			return false;
+		}
+	}
+
+	if (options.device == nullptr || options.hexPath == nullptr)
+		return false;
+	if (options.expectFull && options.diffPath == nullptr)
+		return false;
+
+	// The name of the file, without extension
+	if (options.image.empty()) {
+		options.image = options.hexPath;
+		options.image = options.image.substr(options.image.find_last_of('/') + 1);
+		options.image = options.image.substr(0, options.image.find('.'));
+	}
+	return true;
+}
+
+static void printPhase(const BenchOptions &options, const TransmitterPhase &phase)
+{
+	printf("bench,%s,%s,%s,%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+	       options.device, options.image.c_str(), SIM_BACKEND, phase.name.c_str(),
+	       (unsigned long long)(phase.cycles / (F_CPU / 1000000UL)),
+	       (unsigned long long)phase.bytesSent,
+	       (unsigned long long)phase.bytesReceived,
+	       (unsigned long long)phase.roundTrips,
+	       (unsigned long long)phase.clockEdges,
+	       (unsigned long long)phase.words,
+	       (unsigned long long)phase.categoryCycles[SIM_PIN],
+	       (unsigned long long)phase.categoryCycles[SIM_DELAY],
+	       (unsigned long long)phase.categoryCycles[SIM_TIMER],
+	       (unsigned long long)phase.categoryCycles[SIM_SERIAL]);
+}
+
+static unsigned int compareTarget(const SimTarget &target, const HexImage &hex, const BenchDevice &device,
+                                  bool twoBytesPerAddress)
+{
+	// Every word of the hex file has to be
+	// found in the memory of the target.
+	unsigned int mismatches = 0;
+	for (const std::pair<const uint32_t, uint8_t> &byte : hex.bytes) {
+		bool data = device.dataAddress != -1 && byte.first >= (unsigned long)device.dataAddress;
+
+		long expected;
+		long actual;
+		if (twoBytesPerAddress) {
+			// Words are compared at the low byte
+			if (byte.first & 0x1)
+				continue;
+
+			std::map<uint32_t, uint8_t>::const_iterator high = hex.bytes.find(byte.first + 1);
+			unsigned int mask = data ? 0xFF : 0x3FFF;
+			expected = (((high != hex.bytes.end() ? high->second : 0xFF) << 8) | byte.second) & mask;
+			actual = target.peek(byte.first >> 1);
+			if (actual != -1)
+				actual &= mask;
+		} else {
+			expected = byte.second;
+			actual = target.peek(byte.first);
+			if (actual != -1)
+				actual &= 0xFF;
+		}
+
+		if (actual != expected) {
+			if (mismatches == 0)
+				fprintf(stderr, "%s: %lx at %x does not match hex: %lx\n",
+				        target.name.c_str(), actual, byte.first, expected);
+			mismatches++;
+		}
+	}
+
+	return mismatches;
+}
+
+static std::set<uint32_t> findChangedRows(const HexImage &original, const HexImage &hex, const BenchDevice &device)
+{
+	// The rows of program memory with a word of
+	// the hex file, which differs from the word
+	// of the original. Missing bytes are erased.
+	std::set<uint32_t> changedRows;
+	if (device.rowSize == 0)
+		return changedRows;
+
+	for (const std::pair<const uint32_t, uint8_t> &byte : hex.bytes) {
+		uint32_t wordAddress = byte.first >> 1;
+		if (wordAddress >= device.configAddress)
+			continue;
+
+		std::map<uint32_t, uint8_t>::const_iterator originalByte = original.bytes.find(byte.first);
+		if (originalByte == original.bytes.end() || originalByte->second != byte.second)
+			changedRows.insert(wordAddress - wordAddress % device.rowSize);
+	}
+	return changedRows;
+}
+
+static bool checkDiff(const BenchOptions &options, const BenchDevice &device, const SimTarget &target,
+                      unsigned int index, const std::set<uint32_t> &changedRows, bool differential)
+{
+	// Only the changed rows are erased, each
+	// once, and only those rows are written.
+	std::set<uint32_t> erasedRows(target.erasedRows.begin(), target.erasedRows.end());
+	bool ok;
+	if (options.expectFull) {
+		ok = !differential && target.numBulkErases != 0;
+	} else {
+		ok = differential && target.numBulkErases == 0 && erasedRows == changedRows &&
+		     target.erasedRows.size() == erasedRows.size() && !target.programmedRows.empty();
+		for (uint32_t row : target.programmedRows)
+			ok &= changedRows.count(row - row % device.rowSize) != 0;
+	}
+
+	printf("diff,%s,%s,%s,%u,%s,%u,%u,%u,%llu,%s\n", options.device, options.image.c_str(), SIM_BACKEND, index,
+	       differential ? "rows" : "full", (unsigned int)changedRows.size(), (unsigned int)target.erasedRows.size(),
+	       (unsigned int)target.programmedRows.size(), (unsigned long long)target.numBulkErases, ok ? "pass" : "fail");
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		usage();
+		return 2;
+	}
+
+	const BenchDevice *device = nullptr;
+	for (const BenchDevice &candidate : DEVICES) {
+		if (strcmp(candidate.name, options.device) == 0)
+			device = &candidate;
+	}
+	if (device == nullptr) {
+		fprintf(stderr, "Unknown device: %s\n", options.device);
+		return 2;
+	}
+
+	HexImage hex;
+	if (!hex.read(options.hexPath)) {
+		fprintf(stderr, "Unable to read hex file: %s\n", options.hexPath);
+		return 2;
+	}
+	HexImage original;
+	if (options.diffPath != nullptr && !original.read(options.diffPath)) {
+		fprintf(stderr, "Unable to read hex file: %s\n", options.diffPath);
+		return 2;
+	}
+
+	// One target on ICSPDAT, and one on every
+	// data pin of the gang.
+	std::vector<std::unique_ptr<SimTarget>> targets;
+	targets.emplace_back(createTarget(device->name, ICSPDAT));
+#ifdef ICSP_GANG_DATA_MASK
+	for (uint8_t pin = 0; pin < 8; pin++) {
+		if (ICSP_GANG_DATA_MASK & (1 << pin))
+			targets.emplace_back(createTarget(device->name, pin));
+	}
+#endif
+	for (std::unique_ptr<SimTarget> &target : targets)
+		SimPins::attach(target.get());
+	for (const BenchFault &fault : options.faults) {
+		if (fault.target >= targets.size()) {
+			fprintf(stderr, "No target %u\n", fault.target);
+			return 2;
+		}
+		targets[fault.target]->setFault(fault.address, fault.mask);
+	}
+
+	printf("bench,device,image,backend,phase,micros,bytes_sent,bytes_received,round_trips,icsp_edges,words,"
+	       "pin_cycles,delay_cycles,timer_cycles,serial_cycles\n");
+	printf("fwstats,device,image,backend,commands,icsp_bits,delay_us,bytes_in,bytes_out,wait_us,skipped_words,"
+	       "programmer_bytes,write_buffer_bytes,receive_buffer_bytes,max_bytes_in_flight\n");
+	printf("result,device,image,backend,target,violations,mismatches,verified,status\n");
+	if (options.diffPath != nullptr)
+		printf("diff,device,image,backend,target,programming,changed_rows,erased_rows,programmed_rows,"
+		       "bulk_erases,status\n");
+
+	SimSerial::latencyCycles = SimClock::fromMicros(options.latencyMicros);
+	SimHost::start();
+
+	bool twoBytesPerAddress = true;
+	bool differential = false;
+	std::vector<bool> passed;
+	std::string error;
+	try {
+		Transmitter transmitter(options.baudrate);
+		transmitter.waitForPowerGood();
+		if (options.loseConfirm)
+			transmitter.loseBaudrateConfirm();
+		if (options.negotiate)
+			fprintf(stderr, "Transfer baudrate: %lu\n", transmitter.negotiateBaudrate());
+
+		transmitter.beginPhase("start");
+		uint8_t mode = device->mode;
+		if (!options.highVoltage)
+			mode |= LOW_VOLTAGE_PROGRAMMING_MASK;
+		twoBytesPerAddress = (transmitter.begin(mode) & TWO_BYTES_PER_ADDRESS) != 0;
+
+		int deviceId = transmitter.readDeviceId();
+		if (deviceId != device->deviceId)
+			throw ProgrammingError("Connected device does not match target device: " + std::to_string(deviceId));
+		printPhase(options, transmitter.endPhase());
+
+		transmitter.setPipelineWindow(options.pipelineWindow);
+		transmitter.setCompressBlocks(options.compress);
+		transmitter.setDataAddress(device->dataAddress);
+
+		transmitter.beginPhase("erase");
+		transmitter.eraseDevice();
+		printPhase(options, transmitter.endPhase());
+
+		transmitter.beginPhase("write");
+		transmitter.writeImage(options.diffPath != nullptr ? original : hex, twoBytesPerAddress);
+		printPhase(options, transmitter.endPhase());
+
+		if (options.diffPath != nullptr) {
+			transmitter.drainPipeline();
+			for (std::unique_ptr<SimTarget> &target : targets)
+				target->clearOperations();
+
+			transmitter.beginPhase("diff");
+			differential = transmitter.writeChangedRows(hex, twoBytesPerAddress, device->rowSize, device->configAddress);
+			printPhase(options, transmitter.endPhase());
+		}
+
+		transmitter.beginPhase("verify");
+		std::string verifyError;
+		try {
+			transmitter.verifyImage(hex, twoBytesPerAddress);
+		} catch (ProgrammingError &e) {
+			verifyError = e.what();
+		}
+		printPhase(options, transmitter.endPhase());
+
+		// The gang targets are reported, even if
+		// the primary target failed.
+		passed = transmitter.readTargetResults(verifyError.empty());
+		if (!verifyError.empty())
+			throw ProgrammingError(verifyError);
+
+		std::vector<unsigned long> counters = transmitter.readFirmwareStatistics();
+		printf("fwstats,%s,%s,%s", options.device, options.image.c_str(), SIM_BACKEND);
+		for (unsigned long counter : counters)
+			printf(",%lu", counter);
+		printf(",%u\n", transmitter.getMaxBytesInFlight());
+		if (transmitter.getMaxBytesInFlight() < options.minBytesInFlight)
+			error = "Less than " + std::to_string(options.minBytesInFlight) + " bytes were in flight";
+
+		transmitter.stop();
+	} catch (ProgrammingError &e) {
+		error = e.what();
+	}
+
+	SimHost::stop();
+	SimPins::detachAll();
+
+	if (!error.empty())
+		fprintf(stderr, "%s\n", error.c_str());
+	if (SimSerial::droppedBytes != 0)
+		fprintf(stderr, "Dropped %llu bytes, the serial buffer was full\n", (unsigned long long)SimSerial::droppedBytes);
+
+	bool success = error.empty();
+	for (size_t i = 0; i < targets.size(); i++) {
+		SimTarget &target = *targets[i];
+		unsigned int mismatches = compareTarget(target, hex, *device, twoBytesPerAddress);
+		bool targetPassed = i < passed.size() && passed[i];
+
+		for (const std::string &violation : target.violations)
+			fprintf(stderr, "%s: %s\n", target.name.c_str(), violation.c_str());
+
+		bool ok = targetPassed && mismatches == 0 && target.numViolations == 0;
+		if (options.diffPath != nullptr)
+			ok &= checkDiff(options, *device, target, i, findChangedRows(original, hex, *device), differential);
+		printf("result,%s,%s,%s,%u,%llu,%u,%s,%s\n", options.device, options.image.c_str(), SIM_BACKEND, (unsigned int)i,
+		       (unsigned long long)target.numViolations, mismatches, targetPassed ? "pass" : "fail", ok ? "pass" : "fail");
+		success &= ok;
+	}
+
+	return success ? 0 : 1;
+}
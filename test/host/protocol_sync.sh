@@ -0,0 +1,79 @@
+#!/bin/sh
+#
+# Checks that the port of the transmitter to the host
+# build (transmitter.h, transmitter.cpp) is in step with
+# the transmitter (src/processing_code). The constants,
+# the baudrate negotiation, the firmware statistics and
+# the commands sent have to be the same. Prints every
+# difference, and exits with a non-zero status if there
+# is one.
+#
+#   test/host/protocol_sync.sh
+#
+# The benchmark and the tests only run the port, so a
+# change of the protocol has to be made in both.
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+JAVA=$ROOT/src/processing_code
+HOST=$ROOT/test/host
+
+# Commands of Programmer.java, which are not used
+# by the hex processors, and aren't ported.
+NOT_PORTED='l p r'
+
+status=0
+
+# Prints the differences of two values
+compare() {
+	if [ "$2" != "$3" ]; then
+		echo "$1: $2 (processing_code) != $3 (host)"
+		status=1
+	fi
+}
+
+# The value of a static final constant
+java_constant() {
+	sed -n "s/.* $2 = \(.*\);.*/\1/p" "$JAVA/$1" | sed 's/L$//'
+}
+
+# The value of a TRANSMITTER_ definition
+host_constant() {
+	sed -n "s/^#define TRANSMITTER_$1 *\(.*\)$/\1/p" "$HOST/transmitter.h"
+}
+
+# The elements of an array, without casts
+array() {
+	sed -n "s/.* $2\(\[\]\)\{0,1\} = {\(.*\)};.*/\2/p" "$1" | sed 's/(byte)//g; s/ //g'
+}
+
+for constant in Programmer.java:DEFAULT_WRITE_BUFFER_SIZE Programmer.java:DEFAULT_BYTES_IN_FLIGHT \
+		Programmer.java:RECEIVE_TIMEOUT_MILLIS Programmer.java:BAUDRATE_TIMEOUT_MILLIS \
+		Programmer.java:MAX_TOKEN_LENGTH Programmer.java:MIN_RUN_LENGTH \
+		HexProcessor.java:MIN_ERASED_RUN HexReadProcessor.java:MAX_VERIFY_BYTES \
+		HexDiffProcessor.java:ERASED_WORD; do
+	file=${constant%%:*}
+	name=${constant#*:}
+	compare "$name" "$(java_constant "$file" "$name")" "$(host_constant "$name")"
+done
+
+for name in NEGOTIATED_BAUDRATES BAUDRATE_PATTERN; do
+	compare "$name" "$(array "$JAVA/Programmer.java" "$name")" "$(array "$HOST/transmitter.cpp" "$name")"
+done
+
+# The names of the firmware statistics are the
+# columns of pic_bench.
+statistics=$(sed -n '/FIRMWARE_STATISTICS = {/,/};/p' "$JAVA/Programmer.java" | grep -o '"[a-z_]*"' | tr -d '"')
+compare FIRMWARE_STATISTICS "$(echo "$statistics" | wc -l | tr -d ' ')" "$(host_constant FIRMWARE_STATISTICS)"
+columns=$(tr -d '\n\t' < "$HOST/pic_bench.cpp" | sed 's/" *"//g' | grep -o 'fwstats,device,image,backend,[a-z_][a-z_,]*' |
+	head -n 1 | cut -d , -f 5- | tr ',' '\n')
+compare "fwstats columns" "$(echo "$statistics" | tr '\n' ' ')" "$(echo "$columns" | head -n "$(echo "$statistics" | wc -l)" | tr '\n' ' ')"
+
+# The command characters sent or expected
+java_commands=$(cat "$JAVA"/*.java "$JAVA"/*.pde | grep -o "(byte)'.'\|_SIG = '.'" | grep -o "'.'" | tr -d "'" | sort -u)
+for command in $NOT_PORTED; do
+	java_commands=$(echo "$java_commands" | grep -vx "$command")
+done
+host_commands=$(grep -o "'.'" "$HOST/transmitter.cpp" | tr -d "'" | sort -u)
+compare commands "$(echo "$java_commands" | tr -d '\n')" "$(echo "$host_commands" | tr -d '\n')"
+
+exit $status
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <Arduino.h>
+
+// Approximate cost, in cpu cycles, of the calls
+// to the Arduino core on a 16 MHz ATmega328P.
+// Only these calls advance the modelled clock,
+// the firmware's own code is free.
+#define SIM_PIN_MODE_CYCLES         56
+#define SIM_DIGITAL_WRITE_CYCLES    56
+#define SIM_DIGITAL_READ_CYCLES     52
+// SBI/CBI on a port bit, IN of a port
+#define SIM_PORT_WRITE_CYCLES        2
+#define SIM_PORT_READ_CYCLES         1
+#define SIM_MICROS_CYCLES           48
+#define SIM_MILLIS_CYCLES           32
+#define SIM_SERIAL_AVAILABLE_CYCLES 20
+#define SIM_SERIAL_READ_CYCLES      32
+#define SIM_SERIAL_WRITE_CYCLES     40
+
+// What the modelled cycles were spent on
+enum SimCategory
+{
+	SIM_PIN,
+	SIM_DELAY,
+	SIM_TIMER,
+	SIM_SERIAL,
+
+	SIM_NUM_CATEGORIES
+};
+
+// ----------------- MODELLED CLOCK ------------------- //
+
+class SimClock
+{
+
+public:
+	// The cycles elapsed since the start of
+	// the simulation, in total and by what
+	// they were spent on.
+	static uint64_t cycles;
+	static uint64_t categoryCycles[SIM_NUM_CATEGORIES];
+
+	// Called after every advance of the clock,
+	// if set. Lets the transmitter and the
+	// serial port catch up with the firmware.
+	static void (*listener)();
+
+	static void advance(uint64_t numCycles, SimCategory category)
+	{
+		cycles += numCycles;
+		categoryCycles[category] += numCycles;
+
+		if (listener != nullptr)
+			listener();
+	}
+
+	static uint64_t micros()
+	{
+		return cycles / (F_CPU / 1000000UL);
+	}
+
+	static uint64_t nanos(uint64_t numCycles)
+	{
+		return numCycles * 1000UL / (F_CPU / 1000000UL);
+	}
+
+	static uint64_t fromMicros(uint64_t us)
+	{
+		return us * (F_CPU / 1000000UL);
+	}
+
+	static uint64_t fromNanos(uint64_t ns)
+	{
+		// Rounded up, so the result is never
+		// shorter than the requested time.
+		return (ns * (F_CPU / 1000000UL) + 999) / 1000;
+	}
+
+private:
+	// SimClock is a static class.
+	SimClock() { };
+};
@@ -0,0 +1,106 @@
+#include "./sim_host.h"
+
+#include "./sim_clock.h"
+#include "./sim_serial.h"
+
+// Implemented by the sketch
+void setup();
+void loop();
+
+// Thrown on the firmware thread to unwind
+// it, when the simulation is stopped.
+struct SimStop { };
+
+std::thread SimHost::thread;
+std::mutex SimHost::mutex;
+std::condition_variable SimHost::turnChanged;
+bool SimHost::firmwareTurn = false;
+bool SimHost::stopping = false;
+
+size_t SimHost::waitBytes = 0;
+uint64_t SimHost::waitUntil = 0;
+
+void SimHost::start()
+{
+	stopping = false;
+	firmwareTurn = false;
+	thread = std::thread(run);
+}
+
+void SimHost::stop()
+{
+	if (!thread.joinable())
+		return;
+
+	stopping = true;
+	switchTo(true);
+	thread.join();
+}
+
+bool SimHost::waitForBytes(size_t numBytes, uint64_t timeoutMicros)
+{
+	if (SimSerial::hostAvailable() >= numBytes)
+		return true;
+
+	waitBytes = numBytes;
+	waitUntil = SimClock::cycles + SimClock::fromMicros(timeoutMicros);
+	switchTo(true);
+
+	return SimSerial::hostAvailable() >= numBytes;
+}
+
+void SimHost::waitMicros(uint64_t micros)
+{
+	waitBytes = (size_t)-1;
+	waitUntil = SimClock::cycles + SimClock::fromMicros(micros);
+	switchTo(true);
+}
+
+void SimHost::run()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		turnChanged.wait(lock, [] { return firmwareTurn; });
+	}
+
+	try {
+		if (stopping)
+			throw SimStop();
+
+		SimClock::listener = checkpoint;
+		setup();
+		while (true)
+			loop();
+	} catch (SimStop &) {
+	}
+
+	SimClock::listener = nullptr;
+	switchTo(false);
+}
+
+void SimHost::checkpoint()
+{
+	// Called on the firmware thread, whenever
+	// the clock advances.
+	if (SimClock::cycles < waitUntil && SimSerial::hostAvailable() < waitBytes)
+		return;
+
+	switchTo(false);
+	if (stopping)
+		throw SimStop();
+}
+
+void SimHost::switchTo(bool firmware)
+{
+	// Hands the turn over, and waits for it
+	// to be handed back.
+	std::unique_lock<std::mutex> lock(mutex);
+	firmwareTurn = firmware;
+	turnChanged.notify_all();
+
+	// The firmware thread ends without
+	// waiting for the turn.
+	if (!firmware && stopping && SimClock::listener == nullptr)
+		return;
+	turnChanged.wait(lock, [firmware] { return firmwareTurn != firmware; });
+}
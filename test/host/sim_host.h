@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// ------------------ FIRMWARE RUNNER ----------------- //
+
+// Runs the firmware (setup and loop) on a thread of
+// its own. Only one of the firmware and the caller
+// (the transmitter) runs at a time. The firmware
+// runs while the transmitter waits, and the modelled
+// clock only advances while the firmware runs.
+class SimHost
+{
+
+public:
+	static void start();
+	static void stop();
+
+	// Runs the firmware, until the transmitter has
+	// received a number of bytes, or the timeout has
+	// passed. Returns whether the bytes arrived.
+	static bool waitForBytes(size_t numBytes, uint64_t timeoutMicros);
+	static void waitMicros(uint64_t micros);
+
+private:
+	// SimHost is a static class.
+	SimHost() { };
+
+	static void run();
+	static void checkpoint();
+	static void switchTo(bool firmware);
+
+	static std::thread thread;
+	static std::mutex mutex;
+	static std::condition_variable turnChanged;
+	static bool firmwareTurn;
+	static bool stopping;
+
+	// The condition, which returns the turn
+	// to the transmitter.
+	static size_t waitBytes;
+	static uint64_t waitUntil;
+};
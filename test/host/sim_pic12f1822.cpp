@@ -0,0 +1,336 @@
+#include "./sim_pic12f1822.h"
+
+// Commands of the specification
+enum
+{
+	CMD_LOAD_CONFIG    = 0x00,
+	CMD_LOAD_PROGRAM   = 0x02,
+	CMD_LOAD_DATA      = 0x03,
+	CMD_READ_PROGRAM   = 0x04,
+	CMD_READ_DATA      = 0x05,
+	CMD_INCREMENT      = 0x06,
+	CMD_BEGIN_INTERNAL = 0x08,
+	CMD_BULK_ERASE     = 0x09,
+	CMD_END_EXTERNAL   = 0x0A,
+	CMD_ERASE_DATA     = 0x0B,
+	CMD_ROW_ERASE      = 0x11,
+	CMD_RESET_ADDRESS  = 0x16,
+	CMD_BEGIN_EXTERNAL = 0x18
+};
+
+#define CMD_BITS     6
+#define PAYLOAD_BITS 16
+#define ERASED_WORD  0x3FFF
+
+// The configuration memory modelled, and the
+// words written by programming it (user IDs
+// and configuration words).
+#define CONFIG_WORDS 32
+#define IS_WRITABLE_CONFIG(index) ((index) < 4 || (index) == 7 || (index) == 8)
+
+// Delay after each command (TDLY)
+#define COMMAND_DELAY_MICROS 1
+
+const SimPIC12F1822_Device SIM_PIC12F1822 = {
+	"PIC12F1822", 0x2701,
+	0x8000, 0xF000, 2048, 256, 16, 16, true, true,
+	2500, 5000, 5000, 1000, 100, 5000, 2500
+};
+
+const SimPIC12F1822_Device SIM_PIC16F1705 = {
+	"PIC16F1705", 0x3055,
+	0x8000, 0xF000, 8192, 0, 32, 32, true, true,
+	2500, 5000, 5000, 1000, 100, 5000, 2500
+};
+
+const SimPIC12F1822_Device SIM_PIC16F883 = {
+	"PIC16F883", 0x2021,
+	0x2000, 0x2100, 4096, 256, 4, 16, false, false,
+	3000, 3000, 6000, 1000, 100, 6000, 6000
+};
+
+SimPIC12F1822::SimPIC12F1822(const SimPIC12F1822_Device &device, uint8_t dataPin)
+	: SimTarget(device.name, dataPin, device.keyEntry ? SIM_KEY_LSB_FIRST : SIM_KEY_NONE),
+	  device(device),
+	  phase(PHASE_COMMAND),
+	  command(0),
+	  shift(0),
+	  numBits(0),
+	  outputWord(0),
+	  address(0),
+	  dataLoaded(false),
+	  dataLatch(0xFF),
+	  configLatch(ERASED_WORD),
+	  externalProgramming(false),
+	  externalStart(0),
+	  latches(device.latches, ERASED_WORD),
+	  program(device.programWords, ERASED_WORD),
+	  config(CONFIG_WORDS, ERASED_WORD),
+	  data(device.dataBytes, 0xFF)
+{
+	config[6] = device.deviceId;
+}
+
+long SimPIC12F1822::peek(uint32_t address) const
+{
+	long value = -1;
+	if (device.dataBytes != 0 && address >= device.dataAddress) {
+		if (address - device.dataAddress < device.dataBytes)
+			value = data[address - device.dataAddress];
+	} else if (address >= device.configAddress) {
+		if (address - device.configAddress < CONFIG_WORDS)
+			value = config[address - device.configAddress];
+	} else if (address < device.programWords) {
+		value = program[address];
+	}
+	return applyFault(address, value);
+}
+
+void SimPIC12F1822::enterProgramming()
+{
+	phase = PHASE_COMMAND;
+	shift = 0;
+	numBits = 0;
+
+	address = 0;
+	dataLoaded = false;
+	externalProgramming = false;
+	for (unsigned int &latch : latches)
+		latch = ERASED_WORD;
+}
+
+void SimPIC12F1822::clockRising()
+{
+	// Data is driven LSb first, from the
+	// rising edge of each payload bit.
+	if (phase == PHASE_READ)
+		drive((outputWord >> numBits) & 0x1);
+}
+
+void SimPIC12F1822::clockFalling(bool bit)
+{
+	switch (phase) {
+	case PHASE_COMMAND:
+		shift |= (bit ? 1 : 0) << numBits;
+		if (++numBits == CMD_BITS) {
+			command = shift;
+			shift = 0;
+			numBits = 0;
+			executeCommand(command);
+		}
+		break;
+	case PHASE_LOAD:
+		shift |= (bit ? 1 : 0) << numBits;
+		if (++numBits == PAYLOAD_BITS) {
+			phase = PHASE_COMMAND;
+			// Start and stop bits are ignored
+			executeLoad((shift >> 1) & ERASED_WORD);
+			shift = 0;
+			numBits = 0;
+		}
+		break;
+	case PHASE_READ:
+		if (++numBits == PAYLOAD_BITS) {
+			release();
+			phase = PHASE_COMMAND;
+			numBits = 0;
+		}
+		break;
+	}
+}
+
+void SimPIC12F1822::executeCommand(unsigned int command)
+{
+	// Only the end of externally timed
+	// programming may follow its beginning.
+	if (externalProgramming && command != CMD_END_EXTERNAL) {
+		violation("command %02X during externally timed programming", command);
+		externalProgramming = false;
+	}
+
+	switch (command) {
+	case CMD_LOAD_CONFIG:
+		address = device.configAddress;
+		phase = PHASE_LOAD;
+		break;
+	case CMD_LOAD_PROGRAM:
+	case CMD_LOAD_DATA:
+		phase = PHASE_LOAD;
+		break;
+	case CMD_READ_PROGRAM:
+		outputWord = readWord() << 1;
+		phase = PHASE_READ;
+		break;
+	case CMD_READ_DATA:
+		outputWord = 0;
+		if (device.dataBytes != 0)
+			outputWord = applyFault(device.dataAddress + address % device.dataBytes,
+			                        data[address % device.dataBytes]) << 1;
+		phase = PHASE_READ;
+		break;
+	case CMD_INCREMENT:
+		incrementAddress();
+		break;
+	case CMD_RESET_ADDRESS:
+		if (!device.resetCommand) {
+			violation("reset address command is not supported");
+			break;
+		}
+		address = 0;
+		break;
+	case CMD_BEGIN_INTERNAL:
+		if (dataLoaded) {
+			programData();
+		} else if (address >= device.configAddress) {
+			programConfig();
+		} else {
+			programRow();
+			setBusy(device.programMicros, "programming program memory (TPINT)");
+		}
+		dataLoaded = false;
+		break;
+	case CMD_BEGIN_EXTERNAL:
+		if (address >= device.configAddress) {
+			violation("externally timed programming of configuration memory");
+			break;
+		}
+		programRow();
+		externalProgramming = true;
+		externalStart = now();
+		setBusy(device.externalProgramMicros, "programming program memory (TPEXT)");
+		break;
+	case CMD_END_EXTERNAL:
+		if (!externalProgramming) {
+			violation("end of externally timed programming, which was not started");
+			break;
+		}
+		externalProgramming = false;
+		setBusy(device.dischargeMicros, "discharging (TDIS)");
+		break;
+	case CMD_BULK_ERASE:
+		for (unsigned int &word : program)
+			word = ERASED_WORD;
+		numBulkErases++;
+		// The configuration memory is only
+		// erased from the configuration space.
+		if (address >= device.configAddress) {
+			for (unsigned int i = 0; i < CONFIG_WORDS; i++) {
+				if (IS_WRITABLE_CONFIG(i))
+					config[i] = ERASED_WORD;
+			}
+		}
+		setBusy(device.bulkEraseMicros, "bulk erasing (TERAB)");
+		break;
+	case CMD_ERASE_DATA:
+		for (unsigned int &byte : data)
+			byte = 0xFF;
+		setBusy(device.bulkEraseMicros, "bulk erasing data memory (TERAB)");
+		break;
+	case CMD_ROW_ERASE:
+		if (address >= device.configAddress) {
+			violation("row erase in configuration memory");
+			break;
+		}
+		for (unsigned int i = 0; i < device.eraseRowWords; i++)
+			program[(address - address % device.eraseRowWords + i) % device.programWords] = ERASED_WORD;
+		erasedRows.push_back(address - address % device.eraseRowWords);
+		setBusy(device.rowEraseMicros, "row erasing (TERAR)");
+		break;
+	default:
+		violation("unknown command %02X", command);
+		return;
+	}
+
+	// The payload or next command follows
+	// after TDLY.
+	setBusy(COMMAND_DELAY_MICROS, "waiting after a command (TDLY)");
+}
+
+void SimPIC12F1822::executeLoad(unsigned int word)
+{
+	switch (command) {
+	case CMD_LOAD_CONFIG:
+		configLatch = word;
+		dataLoaded = false;
+		break;
+	case CMD_LOAD_PROGRAM:
+		if (address >= device.configAddress) {
+			configLatch = word;
+		} else {
+			latches[address % device.latches] = word;
+		}
+		dataLoaded = false;
+		break;
+	case CMD_LOAD_DATA:
+		// The byte is sent in bits 1-8
+		if (word & ~0xFFU)
+			violation("data memory loaded with %04X", word);
+		dataLatch = word & 0xFF;
+		dataLoaded = true;
+		break;
+	}
+}
+
+void SimPIC12F1822::incrementAddress()
+{
+	// The program counter wraps around at
+	// the end of each memory space.
+	address++;
+	if (address == device.configAddress) {
+		address = 0;
+	} else if (address == 2 * device.configAddress) {
+		address = device.configAddress;
+	}
+}
+
+unsigned int SimPIC12F1822::readWord() const
+{
+	// Unimplemented locations read as zero
+	long value = 0;
+	if (address >= device.configAddress) {
+		if (address - device.configAddress < CONFIG_WORDS)
+			value = config[address - device.configAddress];
+	} else {
+		value = program[address % device.programWords];
+	}
+	return applyFault(address, value);
+}
+
+void SimPIC12F1822::programRow()
+{
+	// All latches of the row are programmed,
+	// and reset afterwards. Bits are only
+	// cleared by programming.
+	uint32_t row = address - address % device.latches;
+	programmedRows.push_back(row);
+	for (unsigned int i = 0; i < device.latches; i++) {
+		program[(row + i) % device.programWords] &= latches[i];
+		latches[i] = ERASED_WORD;
+	}
+}
+
+void SimPIC12F1822::programConfig()
+{
+	unsigned int index = address - device.configAddress;
+	if (index >= CONFIG_WORDS || !IS_WRITABLE_CONFIG(index)) {
+		violation("programming of read-only configuration word %04X", address);
+		return;
+	}
+
+	config[index] &= configLatch;
+	configLatch = ERASED_WORD;
+	setBusy(device.configProgramMicros, "programming configuration memory (TPINT)");
+}
+
+void SimPIC12F1822::programData()
+{
+	if (device.dataBytes == 0) {
+		violation("programming of data memory, which is not present");
+		return;
+	}
+
+	// Bytes are erased and written by a
+	// single cycle.
+	data[address % device.dataBytes] = dataLatch;
+	setBusy(device.dataProgramMicros, "programming data memory");
+}
@@ -0,0 +1,111 @@
+/*
+ * Simulated targets of the PIC12F1822 and PIC16F88X
+ * specifications. Both share the 6-bit commands and
+ * 16-bit payloads, and only differ in their memory
+ * layout, timing and entry into programming mode.
+ *
+ * PIC12(L)F1822/PIC16(L)F182X Memory Programming Specification
+ * URL: http://ww1.microchip.com/downloads/en/DeviceDoc/41390D.pdf
+ *
+ * PIC16(L)F88X Memory Programming Specification
+ * URL: http://ww1.microchip.com/downloads/en/DeviceDoc/41287D.pdf
+ */
+
+#pragma once
+
+#include "./sim_target.h"
+
+// The memory layout and the minimum times of
+// a device. Times are in microseconds.
+struct SimPIC12F1822_Device
+{
+	const char *name;
+	// The word at offset 6 of the configuration
+	// memory, including the revision bits.
+	unsigned int deviceId;
+
+	uint32_t configAddress;
+	uint32_t dataAddress;
+	unsigned int programWords;
+	unsigned int dataBytes;
+	// The number of write latches and the
+	// number of words erased by a row erase.
+	unsigned int latches;
+	unsigned int eraseRowWords;
+	// The reset address command is supported
+	bool resetCommand;
+	// Low voltage programming is entered by
+	// the key sequence (otherwise by PGM).
+	bool keyEntry;
+
+	// TPINT of program and configuration
+	// memory, and of data memory.
+	unsigned int programMicros;
+	unsigned int configProgramMicros;
+	unsigned int dataProgramMicros;
+	// TPEXT and TDIS of externally timed
+	// programming.
+	unsigned int externalProgramMicros;
+	unsigned int dischargeMicros;
+	// TERAB and TERAR
+	unsigned int bulkEraseMicros;
+	unsigned int rowEraseMicros;
+};
+
+extern const SimPIC12F1822_Device SIM_PIC12F1822;
+extern const SimPIC12F1822_Device SIM_PIC16F1705;
+extern const SimPIC12F1822_Device SIM_PIC16F883;
+
+class SimPIC12F1822 : public SimTarget
+{
+
+public:
+	SimPIC12F1822(const SimPIC12F1822_Device &device, uint8_t dataPin);
+
+	virtual long peek(uint32_t address) const;
+
+protected:
+	virtual void enterProgramming();
+	virtual void clockRising();
+	virtual void clockFalling(bool data);
+
+private:
+	enum Phase
+	{
+		PHASE_COMMAND,
+		PHASE_LOAD,
+		PHASE_READ
+	};
+
+	void executeCommand(unsigned int command);
+	void executeLoad(unsigned int data);
+	void incrementAddress();
+
+	unsigned int readWord() const;
+	void programRow();
+	void programConfig();
+	void programData();
+
+	const SimPIC12F1822_Device &device;
+
+	Phase phase;
+	unsigned int command;
+	unsigned int shift;
+	unsigned int numBits;
+	unsigned int outputWord;
+
+	// The program counter
+	uint32_t address;
+	// Whether the last load was of data
+	// memory, and its value.
+	bool dataLoaded;
+	unsigned int dataLatch;
+	unsigned int configLatch;
+	bool externalProgramming;
+	uint64_t externalStart;
+
+	std::vector<unsigned int> latches;
+	std::vector<unsigned int> program;
+	std::vector<unsigned int> config;
+	std::vector<unsigned int> data;
+};
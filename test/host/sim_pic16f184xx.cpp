@@ -0,0 +1,263 @@
+#include "./sim_pic16f184xx.h"
+
+// Commands of the specification
+enum
+{
+	CMD_LOAD_PC         = 0x80,
+	CMD_BULK_ERASE      = 0x18,
+	CMD_ROW_ERASE       = 0xF0,
+	CMD_LOAD            = 0x00,
+	CMD_LOAD_INCREMENT  = 0x02,
+	CMD_READ            = 0xFC,
+	CMD_READ_INCREMENT  = 0xFE,
+	CMD_INCREMENT       = 0xF8,
+	CMD_BEGIN_INTERNAL  = 0xE0
+};
+
+#define CMD_BITS     8
+#define PAYLOAD_BITS 24
+#define ERASED_WORD  0x3FFF
+
+#define CONFIG_ADDR  0x8000
+#define DATA_ADDR    0xF000
+
+// The configuration memory modelled, and the
+// words written by programming it (user IDs
+// and configuration words).
+#define CONFIG_WORDS 32
+#define IS_USER_ID(index) ((index) < 4)
+#define IS_CONFIG_WORD(index) ((index) >= 7 && (index) < 12)
+
+// Delay after each command (TDLY)
+#define COMMAND_DELAY_MICROS 1
+
+const SimPIC16F184XX_Device SIM_PIC16F18426 = {
+	"PIC16F18426", 0x30D2, 0x2002,
+	16384, 256, 32,
+	2800, 5600, 8400, 2800
+};
+
+SimPIC16F184XX::SimPIC16F184XX(const SimPIC16F184XX_Device &device, uint8_t dataPin)
+	: SimTarget(device.name, dataPin, SIM_KEY_MSB_FIRST),
+	  device(device),
+	  phase(PHASE_COMMAND),
+	  command(0),
+	  shift(0),
+	  numBits(0),
+	  outputPayload(0),
+	  address(0),
+	  latches(device.latches, ERASED_WORD),
+	  configLatch(ERASED_WORD),
+	  dataLatch(0xFF),
+	  program(device.programWords, ERASED_WORD),
+	  config(CONFIG_WORDS, ERASED_WORD),
+	  data(device.dataBytes, 0xFF)
+{
+	config[5] = device.revisionId;
+	config[6] = device.deviceId;
+}
+
+long SimPIC16F184XX::peek(uint32_t address) const
+{
+	long value = -1;
+	if (address >= DATA_ADDR) {
+		if (address - DATA_ADDR < device.dataBytes)
+			value = data[address - DATA_ADDR];
+	} else if (address >= CONFIG_ADDR) {
+		if (address - CONFIG_ADDR < CONFIG_WORDS)
+			value = config[address - CONFIG_ADDR];
+	} else if (address < device.programWords) {
+		value = program[address];
+	}
+	return applyFault(address, value);
+}
+
+void SimPIC16F184XX::enterProgramming()
+{
+	phase = PHASE_COMMAND;
+	shift = 0;
+	numBits = 0;
+
+	address = 0;
+	for (unsigned int &latch : latches)
+		latch = ERASED_WORD;
+}
+
+void SimPIC16F184XX::clockRising()
+{
+	// Data is driven MSb first, from the
+	// rising edge of each payload bit.
+	if (phase == PHASE_READ)
+		drive((outputPayload >> (PAYLOAD_BITS - 1 - numBits)) & 0x1);
+}
+
+void SimPIC16F184XX::clockFalling(bool bit)
+{
+	switch (phase) {
+	case PHASE_COMMAND:
+		shift = (shift << 1) | (bit ? 1 : 0);
+		if (++numBits == CMD_BITS) {
+			command = shift;
+			shift = 0;
+			numBits = 0;
+			executeCommand(command);
+		}
+		break;
+	case PHASE_LOAD:
+		shift = (shift << 1) | (bit ? 1 : 0);
+		if (++numBits == PAYLOAD_BITS) {
+			phase = PHASE_COMMAND;
+			executePayload(shift);
+			shift = 0;
+			numBits = 0;
+		}
+		break;
+	case PHASE_READ:
+		if (++numBits == PAYLOAD_BITS) {
+			release();
+			phase = PHASE_COMMAND;
+			numBits = 0;
+			if (command == CMD_READ_INCREMENT)
+				address = (address + 1) & 0xFFFF;
+		}
+		break;
+	}
+}
+
+void SimPIC16F184XX::executeCommand(unsigned int command)
+{
+	switch (command) {
+	case CMD_LOAD_PC:
+	case CMD_LOAD:
+	case CMD_LOAD_INCREMENT:
+		phase = PHASE_LOAD;
+		break;
+	case CMD_READ:
+	case CMD_READ_INCREMENT:
+		// Unimplemented locations read as zero
+		outputPayload = (unsigned long)(readWord() & ERASED_WORD) << 1;
+		phase = PHASE_READ;
+		break;
+	case CMD_INCREMENT:
+		address = (address + 1) & 0xFFFF;
+		break;
+	case CMD_BEGIN_INTERNAL:
+		programWord();
+		break;
+	case CMD_BULK_ERASE:
+		bulkErase();
+		setBusy(device.bulkEraseMicros, "bulk erasing (TERAB)");
+		break;
+	case CMD_ROW_ERASE:
+		if (address >= CONFIG_ADDR) {
+			violation("row erase outside of program memory");
+			break;
+		}
+		for (unsigned int i = 0; i < device.latches; i++)
+			program[(address - address % device.latches + i) % device.programWords] = ERASED_WORD;
+		erasedRows.push_back(address - address % device.latches);
+		setBusy(device.rowEraseMicros, "row erasing (TERAR)");
+		break;
+	default:
+		violation("unknown command %02X", command);
+		return;
+	}
+
+	setBusy(COMMAND_DELAY_MICROS, "waiting after a command (TDLY)");
+}
+
+void SimPIC16F184XX::executePayload(unsigned long payload)
+{
+	// The payload is framed by a start and
+	// a stop bit.
+	if (command == CMD_LOAD_PC) {
+		address = (payload >> 1) & 0xFFFF;
+		return;
+	}
+
+	loadWord((payload >> 1) & ERASED_WORD);
+	if (command == CMD_LOAD_INCREMENT)
+		address = (address + 1) & 0xFFFF;
+}
+
+long SimPIC16F184XX::readWord() const
+{
+	long value = 0;
+	if (address >= DATA_ADDR) {
+		if (address - DATA_ADDR < device.dataBytes)
+			value = data[address - DATA_ADDR];
+	} else if (address >= CONFIG_ADDR) {
+		if (address - CONFIG_ADDR < CONFIG_WORDS)
+			value = config[address - CONFIG_ADDR];
+	} else {
+		value = program[address % device.programWords];
+	}
+	return applyFault(address, value);
+}
+
+void SimPIC16F184XX::loadWord(unsigned int word)
+{
+	if (address >= DATA_ADDR) {
+		dataLatch = word & 0xFF;
+	} else if (address >= CONFIG_ADDR) {
+		configLatch = word;
+	} else {
+		latches[address % device.latches] = word;
+	}
+}
+
+void SimPIC16F184XX::programWord()
+{
+	if (address >= DATA_ADDR) {
+		// Bytes of data memory are erased and
+		// written by a single cycle.
+		if (address - DATA_ADDR >= device.dataBytes) {
+			violation("programming of unimplemented data memory %04X", address);
+			return;
+		}
+		data[address - DATA_ADDR] = dataLatch;
+		setBusy(device.configProgramMicros, "programming data memory (TPINT)");
+		return;
+	}
+
+	if (address >= CONFIG_ADDR) {
+		unsigned int index = address - CONFIG_ADDR;
+		if (index >= CONFIG_WORDS || !(IS_USER_ID(index) || IS_CONFIG_WORD(index))) {
+			violation("programming of read-only configuration word %04X", address);
+			return;
+		}
+		config[index] &= configLatch;
+		configLatch = ERASED_WORD;
+		setBusy(device.configProgramMicros, "programming configuration memory (TPINT)");
+		return;
+	}
+
+	// The row of latches is programmed and
+	// reset afterwards.
+	unsigned int row = address - address % device.latches;
+	programmedRows.push_back(row);
+	for (unsigned int i = 0; i < device.latches; i++) {
+		program[(row + i) % device.programWords] &= latches[i];
+		latches[i] = ERASED_WORD;
+	}
+	setBusy(device.programMicros, "programming program memory (TPINT)");
+}
+
+void SimPIC16F184XX::bulkErase()
+{
+	// The memory erased depends on the
+	// program counter.
+	if (address >= DATA_ADDR) {
+		for (unsigned int &byte : data)
+			byte = 0xFF;
+		return;
+	}
+
+	for (unsigned int &word : program)
+		word = ERASED_WORD;
+	numBulkErases++;
+	for (unsigned int i = 0; i < CONFIG_WORDS; i++) {
+		if (IS_CONFIG_WORD(i) || (IS_USER_ID(i) && address >= CONFIG_ADDR))
+			config[i] = ERASED_WORD;
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * Simulated target of the PIC16F184XX specification.
+ *
+ * PIC16(L)F184XX Memory Programming Specification
+ * URL: http://ww1.microchip.com/downloads/en/DeviceDoc/PIC16(L)F184XX%20Programming_DS40001970A.pdf
+ */
+
+#pragma once
+
+#include "./sim_target.h"
+
+// The memory layout and the minimum times of
+// a device. Times are in microseconds.
+struct SimPIC16F184XX_Device
+{
+	const char *name;
+	unsigned int deviceId;
+	unsigned int revisionId;
+
+	unsigned int programWords;
+	unsigned int dataBytes;
+	unsigned int latches;
+
+	// TPINT of program memory, and of
+	// configuration and data memory.
+	unsigned int programMicros;
+	unsigned int configProgramMicros;
+	// TERAB and TERAR
+	unsigned int bulkEraseMicros;
+	unsigned int rowEraseMicros;
+};
+
+extern const SimPIC16F184XX_Device SIM_PIC16F18426;
+
+class SimPIC16F184XX : public SimTarget
+{
+
+public:
+	SimPIC16F184XX(const SimPIC16F184XX_Device &device, uint8_t dataPin);
+
+	virtual long peek(uint32_t address) const;
+
+protected:
+	virtual void enterProgramming();
+	virtual void clockRising();
+	virtual void clockFalling(bool data);
+
+private:
+	enum Phase
+	{
+		PHASE_COMMAND,
+		PHASE_LOAD,
+		PHASE_READ
+	};
+
+	void executeCommand(unsigned int command);
+	void executePayload(unsigned long payload);
+
+	long readWord() const;
+	void loadWord(unsigned int word);
+	void programWord();
+	void bulkErase();
+
+	const SimPIC16F184XX_Device &device;
+
+	Phase phase;
+	unsigned int command;
+	unsigned long shift;
+	unsigned int numBits;
+	unsigned long outputPayload;
+
+	// The 16-bit program counter
+	unsigned int address;
+
+	std::vector<unsigned int> latches;
+	unsigned int configLatch;
+	unsigned int dataLatch;
+
+	std::vector<unsigned int> program;
+	std::vector<unsigned int> config;
+	std::vector<unsigned int> data;
+};
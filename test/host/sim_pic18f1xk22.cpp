@@ -0,0 +1,436 @@
+#include "./sim_pic18f1xk22.h"
+
+#include <string.h>
+
+// 4-bit commands of the specification
+enum
+{
+	CMD_CORE           = 0x0,
+	CMD_SHIFT_TABLAT   = 0x2,
+	CMD_TABLE_READ     = 0x8,
+	CMD_TABLE_READ_POI = 0x9,
+	CMD_TABLE_READ_POD = 0xA,
+	CMD_TABLE_READ_PRI = 0xB,
+	CMD_TABLE_WRITE    = 0xC,
+	CMD_TABLE_WRITE_PI = 0xD,
+	CMD_TABLE_WRITE_SP_PI = 0xE,
+	CMD_TABLE_WRITE_SP = 0xF
+};
+
+#define CMD_BITS     4
+#define OPERAND_BITS 16
+
+// Special function registers in the access bank
+#define REG_EECON1  0xA6
+#define REG_EEDATA  0xA8
+#define REG_EEADR   0xA9
+#define REG_WREG    0xE8
+#define REG_TABLAT  0xF5
+#define REG_TBLPTRL 0xF6
+#define REG_TBLPTRH 0xF7
+#define REG_TBLPTRU 0xF8
+
+// Bits of EECON1
+#define EECON1_RD    0x01
+#define EECON1_WR    0x02
+#define EECON1_WREN  0x04
+#define EECON1_CFGS  0x40
+#define EECON1_EEPGD 0x80
+
+#define ID_ADDR           0x200000
+#define ID_BYTES          8
+#define CONFIG_ADDR       0x300000
+#define CONFIG_BYTES      14
+#define ERASE_CONTROL_ADDR 0x3C0004
+#define DEVICE_ID_ADDR    0x3FFFFE
+#define DATA_ADDR         0xF00000
+
+// The erase control value of a chip erase
+#define CHIP_ERASE 0x0F8F
+
+const SimPIC18F1XK22_Device SIM_PIC18F13K22 = {
+	"PIC18F13K22", 0x4F40,
+	8192, 256, 8,
+	1000, 5000, 100, 5000, 4000
+};
+
+SimPIC18F1XK22::SimPIC18F1XK22(const SimPIC18F1XK22_Device &device, uint8_t dataPin)
+	: SimTarget(device.name, dataPin, SIM_KEY_NONE),
+	  device(device),
+	  phase(PHASE_COMMAND),
+	  command(0),
+	  shift(0),
+	  numBits(0),
+	  pending(PENDING_NONE),
+	  pendingAddress(0),
+	  pendingByte(0xFF),
+	  fourthRising(0),
+	  workingRegister(0),
+	  eraseControl(0),
+	  dataWriteUntil(0),
+	  holding(device.holdingRegisters, 0xFF),
+	  flash(device.flashBytes, 0xFF),
+	  ids(ID_BYTES, 0xFF),
+	  config(CONFIG_BYTES, 0xFF),
+	  data(device.dataBytes, 0xFF)
+{
+	memset(registers, 0, sizeof(registers));
+}
+
+long SimPIC18F1XK22::peek(uint32_t address) const
+{
+	long value = -1;
+	if (address >= DATA_ADDR) {
+		if (address - DATA_ADDR < device.dataBytes)
+			value = data[address - DATA_ADDR];
+	} else if (address >= CONFIG_ADDR) {
+		if (address - CONFIG_ADDR < CONFIG_BYTES)
+			value = config[address - CONFIG_ADDR];
+	} else if (address >= ID_ADDR) {
+		if (address - ID_ADDR < ID_BYTES)
+			value = ids[address - ID_ADDR];
+	} else if (address < device.flashBytes) {
+		value = flash[address];
+	}
+	return applyFault(address, value);
+}
+
+void SimPIC18F1XK22::enterProgramming()
+{
+	phase = PHASE_COMMAND;
+	shift = 0;
+	numBits = 0;
+	pending = PENDING_NONE;
+
+	memset(registers, 0, sizeof(registers));
+	workingRegister = 0;
+	eraseControl = 0;
+	for (uint8_t &byte : holding)
+		byte = 0xFF;
+}
+
+void SimPIC18F1XK22::clockRising()
+{
+	// The 4th clock starts programming and
+	// is held high for P9.
+	if (phase == PHASE_COMMAND && numBits == CMD_BITS - 1)
+		fourthRising = now();
+
+	// TABLAT is driven LSb first, after the
+	// 8 bits of the operand are clocked in.
+	if (phase == PHASE_READ && numBits >= 8)
+		drive((registers[REG_TABLAT] >> (numBits - 8)) & 0x1);
+}
+
+void SimPIC18F1XK22::clockFalling(bool bit)
+{
+	switch (phase) {
+	case PHASE_COMMAND:
+		shift |= (bit ? 1 : 0) << numBits;
+		if (++numBits == CMD_BITS) {
+			command = shift;
+			shift = 0;
+			numBits = 0;
+			executePending();
+			executeCommand(command);
+		}
+		break;
+	case PHASE_OPERAND:
+		shift |= (bit ? 1 : 0) << numBits;
+		if (++numBits == OPERAND_BITS) {
+			phase = PHASE_COMMAND;
+			executeOperand(shift);
+			shift = 0;
+			numBits = 0;
+		}
+		break;
+	case PHASE_READ:
+		if (++numBits == OPERAND_BITS) {
+			release();
+			phase = PHASE_COMMAND;
+			numBits = 0;
+		}
+		break;
+	}
+}
+
+void SimPIC18F1XK22::executeCommand(unsigned int command)
+{
+	switch (command) {
+	case CMD_CORE:
+	case CMD_TABLE_WRITE:
+	case CMD_TABLE_WRITE_PI:
+	case CMD_TABLE_WRITE_SP_PI:
+	case CMD_TABLE_WRITE_SP:
+		phase = PHASE_OPERAND;
+		break;
+	case CMD_TABLE_READ:
+	case CMD_TABLE_READ_POI:
+	case CMD_TABLE_READ_POD:
+	case CMD_TABLE_READ_PRI:
+		tableRead();
+		phase = PHASE_READ;
+		break;
+	case CMD_SHIFT_TABLAT:
+		phase = PHASE_READ;
+		break;
+	default:
+		violation("unknown command %X", command);
+		phase = PHASE_OPERAND;
+		break;
+	}
+}
+
+void SimPIC18F1XK22::executeOperand(unsigned int operand)
+{
+	switch (command) {
+	case CMD_CORE:
+		executeCore(operand);
+		break;
+	case CMD_TABLE_WRITE:
+	case CMD_TABLE_WRITE_PI:
+	case CMD_TABLE_WRITE_SP_PI:
+	case CMD_TABLE_WRITE_SP:
+		tableWrite(operand);
+		break;
+	}
+}
+
+void SimPIC18F1XK22::executeCore(unsigned int instruction)
+{
+	unsigned int file = instruction & 0xFF;
+	bool banked = (instruction & 0x0100) != 0;
+
+	if (instruction == 0x0000) {
+		// NOP. Starts the erase, once the control
+		// registers have been loaded.
+		if (eraseControl != 0) {
+			if (eraseControl != CHIP_ERASE)
+				violation("unsupported bulk erase %04X", eraseControl);
+			pending = PENDING_BULK_ERASE;
+			eraseControl = 0;
+		}
+	} else if ((instruction & 0xFF00) == 0x0E00) {
+		// MOVLW
+		workingRegister = file;
+	} else if ((instruction & 0xFE00) == 0x6E00 && !banked) {
+		// MOVWF f, ACCESS
+		writeRegister(file, workingRegister);
+	} else if ((instruction & 0xFE00) == 0x5000 && !banked) {
+		// MOVF f, W, ACCESS
+		workingRegister = readRegister(file);
+	} else if ((instruction & 0xE000) == 0x8000 && !banked) {
+		// BSF / BCF f, b, ACCESS
+		uint8_t mask = 1 << ((instruction >> 9) & 0x7);
+		bool set = (instruction & 0x1000) == 0;
+		// The bits of EECON1 are modified without
+		// the state of the write (WR).
+		uint8_t value = file == REG_EECON1 ? registers[file] : readRegister(file);
+		writeRegister(file, set ? (value | mask) : (value & ~mask));
+	} else {
+		violation("unsupported core instruction %04X", instruction);
+	}
+}
+
+void SimPIC18F1XK22::executePending()
+{
+	// Programming is started by the 4th clock
+	// of the instruction following the table
+	// write, which is held high for P9.
+	uint64_t heldMicros = (now() - fourthRising) / (F_CPU / 1000000UL);
+
+	switch (pending) {
+	case PENDING_NONE:
+		return;
+	case PENDING_PROGRAM: {
+		if (heldMicros < device.programMicros)
+			violation("4th clock held high for %llu us (P9)", (unsigned long long)heldMicros);
+
+		uint32_t block = pendingAddress - pendingAddress % device.holdingRegisters;
+		programmedRows.push_back(block);
+		for (unsigned int i = 0; i < device.holdingRegisters; i++) {
+			if (block + i < device.flashBytes)
+				flash[block + i] &= holding[i];
+			holding[i] = 0xFF;
+		}
+		setBusy(device.dischargeMicros, "discharging (P10)");
+		break;
+	}
+	case PENDING_PROGRAM_CONFIG:
+		if (heldMicros < device.configProgramMicros)
+			violation("4th clock held high for %llu us (P9A)", (unsigned long long)heldMicros);
+
+		if (pendingAddress >= CONFIG_ADDR) {
+			config[pendingAddress - CONFIG_ADDR] = pendingByte;
+		} else {
+			ids[pendingAddress - ID_ADDR] &= pendingByte;
+		}
+		setBusy(device.dischargeMicros, "discharging (P10)");
+		break;
+	case PENDING_BULK_ERASE:
+		// Data is held low during the erase
+		for (uint8_t &byte : flash)
+			byte = 0xFF;
+		numBulkErases++;
+		for (uint8_t &byte : ids)
+			byte = 0xFF;
+		for (uint8_t &byte : config)
+			byte = 0xFF;
+		for (uint8_t &byte : data)
+			byte = 0xFF;
+		setBusy(device.bulkEraseMicros + device.dischargeMicros, "bulk erasing (P11, P10)");
+		break;
+	}
+
+	pending = PENDING_NONE;
+}
+
+void SimPIC18F1XK22::tableRead()
+{
+	uint32_t address = getTablePointer();
+
+	if (command == CMD_TABLE_READ_PRI)
+		address++;
+	registers[REG_TABLAT] = readByte(address);
+	if (command == CMD_TABLE_READ_POI)
+		address++;
+	if (command == CMD_TABLE_READ_POD)
+		address--;
+
+	setTablePointer(address);
+}
+
+void SimPIC18F1XK22::tableWrite(unsigned int operand)
+{
+	uint32_t address = getTablePointer();
+	uint8_t eecon1 = registers[REG_EECON1];
+	bool startProgramming = command == CMD_TABLE_WRITE_SP || command == CMD_TABLE_WRITE_SP_PI;
+	// Byte wide locations are written with
+	// the byte of the operand matching the
+	// address.
+	uint8_t byte = (address & 0x1) ? (operand >> 8) : operand;
+
+	if (startProgramming && !(eecon1 & EECON1_WREN))
+		violation("programming started with writes disabled (WREN)");
+
+	if (address == ERASE_CONTROL_ADDR || address == ERASE_CONTROL_ADDR + 1) {
+		if (address & 0x1) {
+			eraseControl = (eraseControl & 0x00FF) | (byte << 8);
+		} else {
+			eraseControl = (eraseControl & 0xFF00) | byte;
+		}
+	} else if ((address >= CONFIG_ADDR && address < CONFIG_ADDR + CONFIG_BYTES) ||
+	           (address >= ID_ADDR && address < ID_ADDR + ID_BYTES)) {
+		if (address >= CONFIG_ADDR && !(eecon1 & EECON1_CFGS))
+			violation("configuration written without access to it (CFGS)");
+		if (startProgramming) {
+			pending = PENDING_PROGRAM_CONFIG;
+			pendingAddress = address;
+			pendingByte = byte;
+		}
+	} else if (address < device.flashBytes) {
+		if (!(eecon1 & EECON1_EEPGD) || (eecon1 & EECON1_CFGS))
+			violation("flash written without access to it (EEPGD, CFGS)");
+
+		// Two bytes are loaded into the holding
+		// registers, little endian.
+		holding[(address & ~0x1U) % device.holdingRegisters] = operand & 0xFF;
+		holding[(address | 0x1U) % device.holdingRegisters] = (operand >> 8) & 0xFF;
+		if (startProgramming) {
+			pending = PENDING_PROGRAM;
+			pendingAddress = address;
+		}
+	} else {
+		violation("table write to %06X", address);
+	}
+
+	if (command == CMD_TABLE_WRITE_PI || command == CMD_TABLE_WRITE_SP_PI)
+		setTablePointer(address + 2);
+}
+
+uint32_t SimPIC18F1XK22::getTablePointer() const
+{
+	return ((uint32_t)(registers[REG_TBLPTRU] & 0x3F) << 16) |
+	       ((uint32_t)registers[REG_TBLPTRH] << 8) |
+	       registers[REG_TBLPTRL];
+}
+
+void SimPIC18F1XK22::setTablePointer(uint32_t address)
+{
+	registers[REG_TBLPTRU] = (address >> 16) & 0x3F;
+	registers[REG_TBLPTRH] = address >> 8;
+	registers[REG_TBLPTRL] = address;
+}
+
+uint8_t SimPIC18F1XK22::readRegister(unsigned int file) const
+{
+	switch (file) {
+	case REG_WREG:
+		return workingRegister;
+	case REG_EECON1:
+		// WR reads set, until the write of
+		// data memory has completed.
+		if (now() < dataWriteUntil)
+			return registers[file] | EECON1_WR;
+		return registers[file] & ~EECON1_WR;
+	}
+	return registers[file];
+}
+
+void SimPIC18F1XK22::writeRegister(unsigned int file, uint8_t value)
+{
+	if (file == REG_WREG) {
+		workingRegister = value;
+		return;
+	}
+	if (file != REG_EECON1) {
+		registers[file] = value;
+		return;
+	}
+
+	// RD and WR start a read or write of
+	// data memory, and read back cleared.
+	uint8_t eecon1 = value & ~(EECON1_RD | EECON1_WR);
+	registers[file] = eecon1;
+	bool dataAccess = !(eecon1 & (EECON1_EEPGD | EECON1_CFGS));
+
+	if (value & EECON1_RD) {
+		if (!dataAccess || device.dataBytes == 0) {
+			violation("unsupported read (RD) with EECON1 %02X", value);
+		} else {
+			unsigned int index = registers[REG_EEADR] % device.dataBytes;
+			registers[REG_EEDATA] = applyFault(DATA_ADDR + index, data[index]);
+		}
+	}
+
+	if (value & EECON1_WR) {
+		if (!dataAccess || device.dataBytes == 0) {
+			violation("unsupported write (WR) with EECON1 %02X", value);
+		} else if (!(eecon1 & EECON1_WREN)) {
+			violation("data memory written with writes disabled (WREN)");
+		} else if (now() < dataWriteUntil) {
+			violation("data memory written, before the previous write completed");
+		} else {
+			data[registers[REG_EEADR] % device.dataBytes] = registers[REG_EEDATA];
+			dataWriteUntil = now() + SimClock::fromMicros(device.dataProgramMicros);
+		}
+	}
+}
+
+long SimPIC18F1XK22::readByte(uint32_t address) const
+{
+	// Unimplemented locations read as zero
+	long value = 0;
+	if (address >= DEVICE_ID_ADDR && address < DEVICE_ID_ADDR + 2) {
+		return (address & 0x1) ? (device.deviceId >> 8) : (device.deviceId & 0xFF);
+	} else if (address >= CONFIG_ADDR) {
+		if (address - CONFIG_ADDR < CONFIG_BYTES)
+			value = config[address - CONFIG_ADDR];
+	} else if (address >= ID_ADDR) {
+		if (address - ID_ADDR < ID_BYTES)
+			value = ids[address - ID_ADDR];
+	} else if (address < device.flashBytes) {
+		value = flash[address];
+	}
+	return applyFault(address, value);
+}
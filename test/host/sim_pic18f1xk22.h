@@ -0,0 +1,114 @@
+/*
+ * Simulated target of the PIC18F1XK22 specification.
+ * The core instructions used by the programmer are
+ * executed on a model of the registers involved in
+ * programming (table pointer, TABLAT, W and the data
+ * memory registers).
+ *
+ * PIC18F1XK22/LF1XK22 Flash Memory Programming Specification
+ * URL: http://ww1.microchip.com/downloads/en/DeviceDoc/41357B.pdf
+ */
+
+#pragma once
+
+#include "./sim_target.h"
+
+// The memory layout and the minimum times of
+// a device. Times are in microseconds.
+struct SimPIC18F1XK22_Device
+{
+	const char *name;
+	// The two bytes at 3FFFFEh
+	unsigned int deviceId;
+
+	uint32_t flashBytes;
+	unsigned int dataBytes;
+	unsigned int holdingRegisters;
+
+	// P9 and P9A, the time the 4th clock is
+	// held high to program flash and config.
+	unsigned int programMicros;
+	unsigned int configProgramMicros;
+	// P10 (discharge), P11 (bulk erase) and
+	// P11A (data memory write).
+	unsigned int dischargeMicros;
+	unsigned int bulkEraseMicros;
+	unsigned int dataProgramMicros;
+};
+
+extern const SimPIC18F1XK22_Device SIM_PIC18F13K22;
+
+class SimPIC18F1XK22 : public SimTarget
+{
+
+public:
+	SimPIC18F1XK22(const SimPIC18F1XK22_Device &device, uint8_t dataPin);
+
+	virtual long peek(uint32_t address) const;
+
+protected:
+	virtual void enterProgramming();
+	virtual void clockRising();
+	virtual void clockFalling(bool data);
+
+private:
+	enum Phase
+	{
+		PHASE_COMMAND,
+		PHASE_OPERAND,
+		PHASE_READ
+	};
+
+	// What is done at the 4th clock of the
+	// next instruction.
+	enum Pending
+	{
+		PENDING_NONE,
+		PENDING_PROGRAM,
+		PENDING_PROGRAM_CONFIG,
+		PENDING_BULK_ERASE
+	};
+
+	void executeCommand(unsigned int command);
+	void executeOperand(unsigned int operand);
+	void executeCore(unsigned int instruction);
+	void executePending();
+	void tableRead();
+	void tableWrite(unsigned int operand);
+
+	uint32_t getTablePointer() const;
+	void setTablePointer(uint32_t address);
+
+	uint8_t readRegister(unsigned int file) const;
+	void writeRegister(unsigned int file, uint8_t value);
+	long readByte(uint32_t address) const;
+
+	const SimPIC18F1XK22_Device &device;
+
+	Phase phase;
+	unsigned int command;
+	unsigned int shift;
+	unsigned int numBits;
+
+	Pending pending;
+	uint32_t pendingAddress;
+	uint8_t pendingByte;
+	uint64_t fourthRising;
+
+	// Registers of the access bank. Only the
+	// special function registers are used.
+	uint8_t registers[0x100];
+	uint8_t workingRegister;
+	// The bulk erase control registers
+	// (3C0005h:3C0004h)
+	unsigned int eraseControl;
+	// The end of the current write of
+	// data memory (WR bit set).
+	uint64_t dataWriteUntil;
+
+	std::vector<uint8_t> holding;
+	std::vector<uint8_t> flash;
+	std::vector<uint8_t> ids;
+	std::vector<uint8_t> config;
+	std::vector<uint8_t> data;
+};
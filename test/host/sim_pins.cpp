@@ -0,0 +1,82 @@
+#include "./sim_pins.h"
+#include "./sim_target.h"
+
+#include <constants.h>
+
+uint64_t SimPins::clockEdges = 0;
+
+uint8_t SimPins::modes[SIM_NUM_PINS] = { };
+uint8_t SimPins::latches[SIM_NUM_PINS] = { };
+std::vector<SimTarget *> SimPins::targets;
+
+void SimPins::attach(SimTarget *target)
+{
+	targets.push_back(target);
+}
+
+void SimPins::detachAll()
+{
+	targets.clear();
+}
+
+void SimPins::setMode(uint8_t pin, uint8_t mode)
+{
+	if (pin >= SIM_NUM_PINS || modes[pin] == mode)
+		return;
+
+	modes[pin] = mode;
+	notify(pin);
+}
+
+void SimPins::setLatch(uint8_t pin, uint8_t level)
+{
+	if (pin >= SIM_NUM_PINS || latches[pin] == level)
+		return;
+
+	bool rising = level && modes[pin] == OUTPUT;
+	latches[pin] = level;
+	if (rising && pin == ICSPCLK)
+		clockEdges++;
+	notify(pin);
+}
+
+uint8_t SimPins::getMode(uint8_t pin)
+{
+	return pin < SIM_NUM_PINS ? modes[pin] : INPUT;
+}
+
+uint8_t SimPins::getLatch(uint8_t pin)
+{
+	return pin < SIM_NUM_PINS ? latches[pin] : LOW;
+}
+
+uint8_t SimPins::getLevel(uint8_t pin)
+{
+	if (pin >= SIM_NUM_PINS)
+		return LOW;
+
+	if (modes[pin] == OUTPUT)
+		return latches[pin];
+
+	// Sampled from the target driving the
+	// line, if any.
+	for (SimTarget *target : targets) {
+		if (target->dataPin == pin && target->isDriving())
+			return target->sampleOutput();
+	}
+
+	// Pulled low
+	return LOW;
+}
+
+void SimPins::notify(uint8_t pin)
+{
+	// Targets only see the level driven by
+	// the programmer. Released lines are
+	// pulled low.
+	bool output = modes[pin] == OUTPUT;
+	bool level = output && latches[pin];
+
+	for (SimTarget *target : targets)
+		target->pinChanged(pin, level, output);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// The number of digital pins modelled
+#define SIM_NUM_PINS 20
+
+class SimTarget;
+
+// ------------------ MODELLED PINS ------------------- //
+
+// The digital pins of the Arduino. A pin drives its
+// line, when it's an output. Otherwise the line is
+// driven by the target connected to it, or pulled
+// low (all lines of the programmer have pull-downs).
+class SimPins
+{
+
+public:
+	// The number of rising edges of ICSPCLK
+	static uint64_t clockEdges;
+
+	static void attach(SimTarget *target);
+	static void detachAll();
+
+	static void setMode(uint8_t pin, uint8_t mode);
+	static void setLatch(uint8_t pin, uint8_t level);
+
+	static uint8_t getMode(uint8_t pin);
+	static uint8_t getLatch(uint8_t pin);
+	// Samples the level of the line
+	static uint8_t getLevel(uint8_t pin);
+
+private:
+	// SimPins is a static class.
+	SimPins() { };
+
+	static void notify(uint8_t pin);
+
+	static uint8_t modes[SIM_NUM_PINS];
+	static uint8_t latches[SIM_NUM_PINS];
+	static std::vector<SimTarget *> targets;
+};
@@ -0,0 +1,174 @@
+/*
+ * Emulates the programmer on a pseudo terminal, so the
+ * transmitter (processing_code) can be run against the
+ * host build of the firmware and a simulated target.
+ * The path of the terminal is printed as
+ *
+ *   pty,/dev/pts/N
+ *
+ * The firmware starts, when the transmitter opens the
+ * terminal, and runs in step with the wall clock, so
+ * the timeouts of the transmitter hold. The emulator
+ * exits, when the transmitter closes the terminal,
+ * and prints a result line per target:
+ *
+ *   result,device,backend,target,violations,status
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <constants.h>
+
+#include "./sim_clock.h"
+#include "./sim_host.h"
+#include "./sim_pic12f1822.h"
+#include "./sim_pic16f184xx.h"
+#include "./sim_pic18f1xk22.h"
+#include "./sim_pins.h"
+#include "./sim_serial.h"
+
+// The name of the firmware variant
+#ifndef SIM_BACKEND
+#define SIM_BACKEND "digital"
+#endif
+
+// The longest the firmware runs, before the
+// terminal is polled again.
+#define PTY_SLICE_MICROS 1000
+
+static SimTarget *createTarget(const std::string &device, uint8_t dataPin)
+{
+	if (device == "PIC12F1822")
+		return new SimPIC12F1822(SIM_PIC12F1822, dataPin);
+	if (device == "PIC16F1705")
+		return new SimPIC12F1822(SIM_PIC16F1705, dataPin);
+	if (device == "PIC16F883")
+		return new SimPIC12F1822(SIM_PIC16F883, dataPin);
+	if (device == "PIC16F18426")
+		return new SimPIC16F184XX(SIM_PIC16F18426, dataPin);
+	if (device == "PIC18F13K22")
+		return new SimPIC18F1XK22(SIM_PIC18F13K22, dataPin);
+	return nullptr;
+}
+
+static int openTerminal()
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+		return -1;
+
+	// The transmitter sets up its end, but the
+	// bytes must not be translated until then.
+	struct termios settings;
+	if (tcgetattr(master, &settings) == 0) {
+		cfmakeraw(&settings);
+		tcsetattr(master, TCSANOW, &settings);
+	}
+
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	return master;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: sim_pty DEVICE\n");
+		return 2;
+	}
+
+	// One target on ICSPDAT, and one on every
+	// data pin of the gang.
+	std::vector<std::unique_ptr<SimTarget>> targets;
+	targets.emplace_back(createTarget(argv[1], ICSPDAT));
+	if (!targets[0]) {
+		fprintf(stderr, "Unknown device: %s\n", argv[1]);
+		return 2;
+	}
+#ifdef ICSP_GANG_DATA_MASK
+	for (uint8_t pin = 0; pin < 8; pin++) {
+		if (ICSP_GANG_DATA_MASK & (1 << pin))
+			targets.emplace_back(createTarget(argv[1], pin));
+	}
+#endif
+	for (std::unique_ptr<SimTarget> &target : targets)
+		SimPins::attach(target.get());
+
+	int master = openTerminal();
+	if (master < 0) {
+		perror("Unable to open a pseudo terminal");
+		return 1;
+	}
+	printf("pty,%s\n", ptsname(master));
+	fflush(stdout);
+
+	// The programmer boots, when the transmitter
+	// opens the terminal, like an Arduino is
+	// reset by the serial port. The terminal
+	// hangs up, until then.
+	struct pollfd descriptor = { master, POLLIN, 0 };
+	do {
+		poll(&descriptor, 1, 10);
+	} while (descriptor.revents & POLLHUP);
+
+	SimSerial::setHostBaudrate(TRANSFER_BAUDRATE);
+	SimHost::start();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (true) {
+		poll(&descriptor, 1, 1);
+		if (descriptor.revents & POLLHUP)
+			break;
+
+		// The transmitter follows the baudrate
+		// of the firmware, as a terminal has no
+		// baudrate to mismatch.
+		SimSerial::setHostBaudrate(SimSerial::getBaudrate());
+
+		uint8_t buffer[256];
+		ssize_t numBytes = ::read(master, buffer, sizeof(buffer));
+		for (ssize_t i = 0; i < numBytes; i++)
+			SimSerial::hostWrite(buffer[i]);
+
+		uint64_t wallMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		if (wallMicros > SimClock::micros())
+			SimHost::waitMicros(std::min<uint64_t>(wallMicros - SimClock::micros(), PTY_SLICE_MICROS));
+
+		SimSerial::setHostBaudrate(SimSerial::getBaudrate());
+		while (SimSerial::hostAvailable() > 0) {
+			uint8_t data = SimSerial::hostRead();
+			while (::write(master, &data, 1) < 0 && errno == EAGAIN)
+				poll(nullptr, 0, 1);
+		}
+	}
+
+	SimHost::stop();
+	SimPins::detachAll();
+	close(master);
+
+	bool success = true;
+	for (size_t i = 0; i < targets.size(); i++) {
+		SimTarget &target = *targets[i];
+		for (const std::string &violation : target.violations)
+			fprintf(stderr, "%s: %s\n", target.name.c_str(), violation.c_str());
+
+		printf("result,%s,%s,%u,%llu,%s\n", argv[1], SIM_BACKEND, (unsigned int)i,
+		       (unsigned long long)target.numViolations, target.numViolations == 0 ? "pass" : "fail");
+		success &= target.numViolations == 0;
+	}
+
+	return success ? 0 : 1;
+}
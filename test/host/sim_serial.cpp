@@ -0,0 +1,160 @@
+#include "./sim_serial.h"
+
+#include "./sim_clock.h"
+
+// Garbles a byte received at the wrong baudrate
+#define GARBLE_MASK 0xA5
+
+uint64_t SimSerial::latencyCycles = 0;
+uint64_t SimSerial::droppedBytes = 0;
+
+bool SimSerial::enabled = false;
+unsigned long SimSerial::baudrate = 0;
+unsigned long SimSerial::hostBaudrate = 0;
+
+std::deque<SimSerial::Byte> SimSerial::toFirmware;
+std::deque<uint8_t> SimSerial::receiveBuffer;
+uint64_t SimSerial::toFirmwareFree = 0;
+
+std::deque<SimSerial::Byte> SimSerial::toHost;
+std::deque<uint64_t> SimSerial::transmitBuffer;
+uint64_t SimSerial::toHostFree = 0;
+
+void SimSerial::begin(unsigned long baudrate)
+{
+	// Bytes which arrived while disabled
+	// are lost.
+	receive();
+
+	SimSerial::baudrate = baudrate;
+	enabled = true;
+}
+
+void SimSerial::end()
+{
+	receive();
+
+	enabled = false;
+	receiveBuffer.clear();
+}
+
+void SimSerial::flush()
+{
+	// Waits until the last byte is sent
+	if (toHostFree > SimClock::cycles)
+		SimClock::advance(toHostFree - SimClock::cycles, SIM_SERIAL);
+}
+
+int SimSerial::available()
+{
+	SimClock::advance(SIM_SERIAL_AVAILABLE_CYCLES, SIM_SERIAL);
+	receive();
+
+	return receiveBuffer.size();
+}
+
+int SimSerial::read()
+{
+	SimClock::advance(SIM_SERIAL_READ_CYCLES, SIM_SERIAL);
+	receive();
+
+	if (receiveBuffer.empty())
+		return -1;
+
+	uint8_t data = receiveBuffer.front();
+	receiveBuffer.pop_front();
+	return data;
+}
+
+void SimSerial::write(uint8_t data)
+{
+	SimClock::advance(SIM_SERIAL_WRITE_CYCLES, SIM_SERIAL);
+
+	// Blocks, while the transmit buffer is full
+	while (true) {
+		while (!transmitBuffer.empty() && transmitBuffer.front() <= SimClock::cycles)
+			transmitBuffer.pop_front();
+		if (transmitBuffer.size() < SIM_SERIAL_BUFFER_SIZE)
+			break;
+		SimClock::advance(transmitBuffer.front() - SimClock::cycles, SIM_SERIAL);
+	}
+
+	uint64_t start = toHostFree > SimClock::cycles ? toHostFree : SimClock::cycles;
+	toHostFree = start + byteCycles(baudrate);
+	transmitBuffer.push_back(toHostFree);
+
+	Byte sent = { data, enabled ? baudrate : 0, toHostFree + latencyCycles };
+	toHost.push_back(sent);
+}
+
+void SimSerial::setHostBaudrate(unsigned long baudrate)
+{
+	hostBaudrate = baudrate;
+}
+
+void SimSerial::hostWrite(uint8_t data)
+{
+	uint64_t start = SimClock::cycles + latencyCycles;
+	if (toFirmwareFree > start)
+		start = toFirmwareFree;
+	toFirmwareFree = start + byteCycles(hostBaudrate);
+
+	Byte sent = { data, hostBaudrate, toFirmwareFree };
+	toFirmware.push_back(sent);
+}
+
+size_t SimSerial::hostAvailable()
+{
+	// Bytes arrive in order
+	size_t available = 0;
+	while (available < toHost.size() && toHost[available].time <= SimClock::cycles)
+		available++;
+	return available;
+}
+
+int SimSerial::hostRead()
+{
+	if (hostAvailable() == 0)
+		return -1;
+
+	Byte received = toHost.front();
+	toHost.pop_front();
+	if (received.baudrate != hostBaudrate)
+		return received.data ^ GARBLE_MASK;
+	return received.data;
+}
+
+void SimSerial::hostClear()
+{
+	while (hostAvailable() != 0)
+		toHost.pop_front();
+}
+
+uint64_t SimSerial::byteCycles(unsigned long baudrate)
+{
+	// A start bit, 8 data bits and a stop bit
+	if (baudrate == 0)
+		return 0;
+	return (10 * F_CPU + baudrate - 1) / baudrate;
+}
+
+void SimSerial::receive()
+{
+	// Moves the bytes, which have arrived by
+	// now, into the receive buffer.
+	while (!toFirmware.empty() && toFirmware.front().time <= SimClock::cycles) {
+		Byte received = toFirmware.front();
+		toFirmware.pop_front();
+
+		if (!enabled)
+			continue;
+		if (receiveBuffer.size() >= SIM_SERIAL_BUFFER_SIZE) {
+			droppedBytes++;
+			continue;
+		}
+
+		if (received.baudrate != baudrate)
+			received.data ^= GARBLE_MASK;
+		receiveBuffer.push_back(received.data);
+	}
+}
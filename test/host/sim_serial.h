@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <deque>
+
+// The size of the receive and transmit buffers
+// of HardwareSerial on the ATmega328P.
+#define SIM_SERIAL_BUFFER_SIZE 64
+
+// ------------------ MODELLED UART ------------------- //
+
+// The serial connection between the transmitter
+// and the firmware. Every byte takes ten bit times
+// at the baudrate of the sender, and arrives after
+// the latency of the USB bridge. A byte received
+// at a different baudrate than it was sent with
+// is garbled.
+class SimSerial
+{
+
+public:
+	// The one-way latency of the USB bridge, in
+	// cycles of the modelled clock.
+	static uint64_t latencyCycles;
+	// Bytes dropped, because the receive buffer
+	// of the firmware was full.
+	static uint64_t droppedBytes;
+
+	// ---------------- FIRMWARE SIDE ----------------- //
+
+	static void begin(unsigned long baudrate);
+	static void end();
+	static void flush();
+	// The baudrate the firmware is using
+	static unsigned long getBaudrate() { return baudrate; }
+
+	static int available();
+	static int read();
+	static void write(uint8_t data);
+
+	// ---------------- TRANSMITTER SIDE -------------- //
+
+	static void setHostBaudrate(unsigned long baudrate);
+	static void hostWrite(uint8_t data);
+	// The number of bytes received by the
+	// transmitter by now.
+	static size_t hostAvailable();
+	static int hostRead();
+	static void hostClear();
+
+private:
+	// SimSerial is a static class.
+	SimSerial() { };
+
+	struct Byte
+	{
+		uint8_t data;
+		unsigned long baudrate;
+		// When the byte has arrived
+		uint64_t time;
+	};
+
+	static uint64_t byteCycles(unsigned long baudrate);
+	static void receive();
+
+	static bool enabled;
+	static unsigned long baudrate;
+	static unsigned long hostBaudrate;
+
+	// Bytes sent by the transmitter, and bytes
+	// in the receive buffer of the firmware.
+	static std::deque<Byte> toFirmware;
+	static std::deque<uint8_t> receiveBuffer;
+	static uint64_t toFirmwareFree;
+
+	// Bytes sent by the firmware, and the ends
+	// of the bytes still in its transmit buffer.
+	static std::deque<Byte> toHost;
+	static std::deque<uint64_t> transmitBuffer;
+	static uint64_t toHostFree;
+};
@@ -0,0 +1,275 @@
+#include "./sim_target.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <constants.h>
+
+#include "./sim_pins.h"
+
+SimTarget::SimTarget(const std::string &name, uint8_t dataPin, SimKeyEntry keyEntry)
+	: name(name),
+	  dataPin(dataPin),
+	  numViolations(0),
+	  numBulkErases(0),
+	  keyEntry(keyEntry),
+	  state(STATE_OFF),
+	  highVoltageEntry(false),
+	  mclr(false),
+	  power(false),
+	  clock(false),
+	  data(false),
+	  dataOutput(false),
+	  driving(false),
+	  output(false),
+	  key(0),
+	  keyBits(0),
+	  lastRising(0),
+	  lastFalling(0),
+	  lastDataChange(0),
+	  lastOutputChange(0),
+	  busyUntil(0),
+	  busyOperation("")
+{ }
+
+SimTarget::~SimTarget()
+{ }
+
+void SimTarget::pinChanged(uint8_t pin, bool level, bool output)
+{
+	if (pin == dataPin) {
+		// The programmer has to release the
+		// line, while the target drives it.
+		if (driving && output)
+			violation("data line driven by the programmer and the target");
+
+		bool changed = level != data;
+		data = level;
+		dataOutput = output;
+		if (changed)
+			onDataChanged();
+		return;
+	}
+
+	switch (pin) {
+	case PVCC:
+		if (level == power)
+			return;
+		power = level;
+		if (power) {
+			powerOn();
+		} else {
+			powerOff();
+		}
+		break;
+	case MCLR:
+		if (level == mclr)
+			return;
+		mclr = level;
+
+		// Releasing MCLR resets a target, which
+		// entered programming by the voltage on
+		// MCLR.
+		if (!mclr && state == STATE_PROGRAMMING && highVoltageEntry) {
+			release();
+			state = STATE_RUNNING;
+		}
+		break;
+	case ICSPCLK:
+		if (level == clock)
+			return;
+		clock = level;
+		if (clock) {
+			onClockRising();
+		} else {
+			onClockFalling();
+		}
+		break;
+	}
+}
+
+uint8_t SimTarget::sampleOutput()
+{
+	if (now() - lastOutputChange < SimClock::fromNanos(SIM_OUTPUT_DELAY_NS))
+		violation("data sampled %llu ns after the rising edge (TCO)",
+		          (unsigned long long)SimClock::nanos(now() - lastOutputChange));
+	return output ? HIGH : LOW;
+}
+
+void SimTarget::setFault(uint32_t address, unsigned int mask)
+{
+	faults[address] = mask;
+}
+
+void SimTarget::clearOperations()
+{
+	numBulkErases = 0;
+	erasedRows.clear();
+	programmedRows.clear();
+}
+
+void SimTarget::drive(bool level)
+{
+	if (!driving && dataOutput)
+		violation("target drives the data line, while the programmer drives it");
+
+	driving = true;
+	output = level;
+	lastOutputChange = now();
+}
+
+void SimTarget::release()
+{
+	driving = false;
+}
+
+void SimTarget::violation(const char *format, ...)
+{
+	numViolations++;
+	if (violations.size() >= SIM_MAX_VIOLATION_MESSAGES)
+		return;
+
+	char message[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	char prefix[64];
+	snprintf(prefix, sizeof(prefix), "%llu us: ", (unsigned long long)SimClock::micros());
+	violations.push_back(prefix + std::string(message));
+}
+
+void SimTarget::setBusy(uint64_t micros, const char *operation)
+{
+	uint64_t until = now() + SimClock::fromMicros(micros);
+	if (until > busyUntil) {
+		busyUntil = until;
+		busyOperation = operation;
+	}
+}
+
+long SimTarget::applyFault(uint32_t address, long value) const
+{
+	std::map<uint32_t, unsigned int>::const_iterator fault = faults.find(address);
+	if (fault == faults.end() || value < 0)
+		return value;
+	return value & ~(long)fault->second;
+}
+
+void SimTarget::powerOn()
+{
+	// A high voltage on MCLR enters programming
+	// mode directly. Otherwise the key sequence
+	// is expected, if the target has one.
+	if (mclr) {
+		highVoltageEntry = true;
+		beginProgramming();
+	} else if (keyEntry != SIM_KEY_NONE) {
+		highVoltageEntry = false;
+		state = STATE_KEY;
+		key = 0;
+		keyBits = 0;
+	} else {
+		state = STATE_RUNNING;
+	}
+}
+
+void SimTarget::powerOff()
+{
+	release();
+	state = STATE_OFF;
+}
+
+void SimTarget::receiveKeyBit(bool data)
+{
+	keyBits++;
+	if (keyEntry == SIM_KEY_LSB_FIRST) {
+		// The 33rd clock completes the entry
+		if (keyBits == 33) {
+			beginProgramming();
+			return;
+		}
+		if (data)
+			key |= 1UL << (keyBits - 1);
+	} else {
+		key = (key << 1) | (data ? 1 : 0);
+	}
+
+	if (keyBits < 32)
+		return;
+
+	if ((key & 0xFFFFFFFFUL) != SIM_KEY_SEQ) {
+		violation("invalid key sequence %08lX", key & 0xFFFFFFFFUL);
+		state = STATE_RUNNING;
+	} else if (keyEntry == SIM_KEY_MSB_FIRST) {
+		beginProgramming();
+	}
+}
+
+void SimTarget::beginProgramming()
+{
+	state = STATE_PROGRAMMING;
+	release();
+	// Hold time of the serial lines after
+	// entering programming mode (TENTH).
+	busyUntil = 0;
+	setBusy(250, "entering programming mode");
+	enterProgramming();
+}
+
+void SimTarget::onClockRising()
+{
+	uint64_t minEdge = SimClock::fromNanos(SIM_MIN_EDGE_TIME_NS);
+
+	if (state == STATE_RUNNING) {
+		violation("clocked while not in programming mode");
+		return;
+	}
+	if (state != STATE_PROGRAMMING && state != STATE_KEY)
+		return;
+
+	if (now() - lastFalling < minEdge)
+		violation("clock low for %llu ns (TCKL)", (unsigned long long)SimClock::nanos(now() - lastFalling));
+	if (isBusy())
+		violation("clocked %llu us early, while %s",
+		          (unsigned long long)(SimClock::nanos(busyUntil - now()) / 1000 + 1), busyOperation);
+	lastRising = now();
+
+	if (state == STATE_PROGRAMMING)
+		clockRising();
+}
+
+void SimTarget::onClockFalling()
+{
+	uint64_t minEdge = SimClock::fromNanos(SIM_MIN_EDGE_TIME_NS);
+
+	if (state != STATE_PROGRAMMING && state != STATE_KEY)
+		return;
+
+	if (now() - lastRising < minEdge)
+		violation("clock high for %llu ns (TCKH)", (unsigned long long)SimClock::nanos(now() - lastRising));
+	// Data is sampled on the falling edge
+	if (!driving && now() - lastDataChange < minEdge)
+		violation("data set up %llu ns before the falling edge (TDS)",
+		          (unsigned long long)SimClock::nanos(now() - lastDataChange));
+	lastFalling = now();
+
+	if (state == STATE_KEY) {
+		receiveKeyBit(data);
+	} else {
+		clockFalling(data);
+	}
+}
+
+void SimTarget::onDataChanged()
+{
+	uint64_t minEdge = SimClock::fromNanos(SIM_MIN_EDGE_TIME_NS);
+
+	if ((state == STATE_PROGRAMMING || state == STATE_KEY) &&
+	    lastFalling != 0 && now() - lastFalling < minEdge) {
+		violation("data held %llu ns after the falling edge (TDH)",
+		          (unsigned long long)SimClock::nanos(now() - lastFalling));
+	}
+	lastDataChange = now();
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./sim_clock.h"
+
+// The key sequence of low voltage programming
+#define SIM_KEY_SEQ 0x4D434850UL
+
+// The maximum number of violations kept as
+// messages. All of them are counted.
+#define SIM_MAX_VIOLATION_MESSAGES 16
+
+// The minimum setup, hold, clock high and clock
+// low time (TDS, TDH, TCKH, TCKL) and the time
+// until data is driven by the target (TCO) in
+// nanoseconds, shared by all specifications.
+#define SIM_MIN_EDGE_TIME_NS 100
+#define SIM_OUTPUT_DELAY_NS   80
+
+// How a target enters programming mode, when
+// powered with MCLR low.
+enum SimKeyEntry
+{
+	// No key, the target runs
+	SIM_KEY_NONE,
+	// 32-bit key, LSb first and a 33rd clock
+	SIM_KEY_LSB_FIRST,
+	// 32-bit key, MSb first
+	SIM_KEY_MSB_FIRST
+};
+
+// ----------------- SIMULATED TARGET ----------------- //
+
+// A PIC connected to the programmer. The base class
+// follows the power, MCLR and clock lines, decodes
+// the entry into programming mode and checks the
+// timing of every edge. The specifications decode
+// the bits clocked in and out, and model the memory.
+class SimTarget
+{
+
+public:
+	const std::string name;
+	// The pin of the programmer connected to
+	// ICSPDAT of this target.
+	const uint8_t dataPin;
+
+	// Every violation of the specification, with
+	// the first messages kept for the report.
+	uint64_t numViolations;
+	std::vector<std::string> violations;
+
+	// The erase and program operations on the
+	// program memory, by the address of the
+	// first word of the row (byte address on
+	// PIC18). Cleared by the harness.
+	uint64_t numBulkErases;
+	std::vector<uint32_t> erasedRows;
+	std::vector<uint32_t> programmedRows;
+
+public:
+	SimTarget(const std::string &name, uint8_t dataPin, SimKeyEntry keyEntry);
+	virtual ~SimTarget();
+
+	// Called by the pins, when the programmer
+	// changes the level it drives on a line.
+	void pinChanged(uint8_t pin, bool level, bool output);
+
+	bool isDriving() const { return driving; }
+	bool isProgramming() const { return state == STATE_PROGRAMMING; }
+	// The level of the data line sampled by
+	// the programmer, while the target drives.
+	uint8_t sampleOutput();
+
+	// The content of the memory at an address
+	// of the hex file (word address for 14-bit
+	// cores). -1 if nothing is located there.
+	virtual long peek(uint32_t address) const = 0;
+
+	// Bits of the word at the address, which
+	// always read back as zero.
+	void setFault(uint32_t address, unsigned int mask);
+
+	void clearOperations();
+
+protected:
+	// Resets the state of the serial protocol,
+	// when programming mode is entered.
+	virtual void enterProgramming() = 0;
+	// Edges of the clock in programming mode.
+	// The data bit is the level driven by the
+	// programmer at the falling edge.
+	virtual void clockRising() = 0;
+	virtual void clockFalling(bool data) = 0;
+
+	void drive(bool level);
+	void release();
+
+	void violation(const char *format, ...);
+
+	// Clock edges before the operation has
+	// completed are violations.
+	void setBusy(uint64_t micros, const char *operation);
+	bool isBusy() const { return SimClock::cycles < busyUntil; }
+
+	// The value read from an address, including
+	// the injected faults.
+	long applyFault(uint32_t address, long value) const;
+
+	uint64_t now() const { return SimClock::cycles; }
+
+private:
+	enum State
+	{
+		STATE_OFF,
+		STATE_RUNNING,
+		STATE_KEY,
+		STATE_PROGRAMMING
+	};
+
+	void powerOn();
+	void powerOff();
+	void receiveKeyBit(bool data);
+	void beginProgramming();
+
+	void onClockRising();
+	void onClockFalling();
+	void onDataChanged();
+
+	const SimKeyEntry keyEntry;
+	State state;
+	// Entered by a high voltage (or PGM) on
+	// MCLR, left when MCLR is released.
+	bool highVoltageEntry;
+
+	// The levels driven by the programmer
+	bool mclr;
+	bool power;
+	bool clock;
+	bool data;
+	bool dataOutput;
+
+	// The level driven by the target
+	bool driving;
+	bool output;
+
+	unsigned long key;
+	unsigned int keyBits;
+
+	// The time (in cycles) of the last edges
+	uint64_t lastRising;
+	uint64_t lastFalling;
+	uint64_t lastDataChange;
+	uint64_t lastOutputChange;
+
+	uint64_t busyUntil;
+	const char *busyOperation;
+
+	std::map<uint32_t, unsigned int> faults;
+};
@@ -0,0 +1,861 @@
+#include "./transmitter.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "./sim_clock.h"
+#include "./sim_host.h"
+#include "./sim_pins.h"
+#include "./sim_serial.h"
+
+// Command success response sent by the arduino
+#define COMMAND_SUCCESS_DATA 'd'
+#define POWER_GOOD_SIG 'g'
+#define BAUDRATE_CONFIRM 'y'
+
+static const unsigned long NEGOTIATED_BAUDRATES[] = { 1000000, 500000, 250000 };
+static const uint8_t BAUDRATE_PATTERN[] = { 0x55, 0xAA, 0x00, 0xFF, 0x0F, 0x3C };
+
+static std::string hex(unsigned long value)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%lx", value);
+	return buffer;
+}
+
+static unsigned int crc16(unsigned int crc, uint8_t data)
+{
+	// CRC-16/CCITT, like PicMemory::crc16
+	crc ^= (unsigned int)data << 8;
+	for (unsigned int i = 0; i < 8; i++)
+		crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+	return crc & 0xFFFF;
+}
+
+static unsigned int getWord(const uint8_t *data, unsigned int offset, unsigned int numBytes)
+{
+	// Little endian, missing bytes are erased
+	unsigned int b0 = offset < numBytes ? data[offset] : 0xFF;
+	unsigned int b1 = offset + 1 < numBytes ? data[offset + 1] : 0xFF;
+	return (b1 << 8) | b0;
+}
+
+Transmitter::Transmitter(unsigned long baudrate)
+	: baudrate(baudrate),
+	  compressBlocks(false),
+	  loseConfirm(false),
+	  writeBufferSize(TRANSMITTER_DEFAULT_WRITE_BUFFER_SIZE),
+	  receiveBufferSize(TRANSMITTER_DEFAULT_BYTES_IN_FLIGHT),
+	  rowBytes(0),
+	  dataAddress(-1),
+	  pipelineWindow(1),
+	  bytesInFlight(0),
+	  maxBytesInFlight(0),
+	  numCommands(0),
+	  rowSize(0),
+	  extendedAddress(0)
+{
+	SimSerial::setHostBaudrate(baudrate);
+	beginPhase("");
+}
+
+void Transmitter::waitForPowerGood()
+{
+	while (true) {
+		waitForSerial(1);
+
+		// Leading F0h bytes are ignored
+		uint8_t data = read();
+		if (data == POWER_GOOD_SIG)
+			return;
+		if (data != 0xF0)
+			throw ProgrammingError("Unable to connect to programmer");
+	}
+}
+
+unsigned long Transmitter::negotiateBaudrate()
+{
+	// Try the fastest rates first, and keep
+	// the current one, if none of them work.
+	for (unsigned long newBaudrate : NEGOTIATED_BAUDRATES) {
+		if (newBaudrate == baudrate)
+			break;
+		if (tryBaudrate(newBaudrate))
+			break;
+	}
+
+	return baudrate;
+}
+
+bool Transmitter::tryBaudrate(unsigned long newBaudrate)
+{
+	uint8_t command = 'u';
+	drainPipeline();
+	write(std::vector<uint8_t> { command, (uint8_t)(newBaudrate >> 24), (uint8_t)(newBaudrate >> 16),
+	                             (uint8_t)(newBaudrate >> 8), (uint8_t)newBaudrate });
+	checkCommand(command);
+	try {
+		checkFeedback(command);
+	} catch (ProgrammingError &) {
+		// The baudrate is not supported
+		return false;
+	}
+
+	SimSerial::setHostBaudrate(newBaudrate);
+	try {
+		// The programmer echoes the pattern,
+		// and keeps the new rate if we confirm.
+		write(std::vector<uint8_t>(BAUDRATE_PATTERN, BAUDRATE_PATTERN + sizeof(BAUDRATE_PATTERN)));
+
+		waitForSerial(sizeof(BAUDRATE_PATTERN), TRANSMITTER_BAUDRATE_TIMEOUT_MILLIS / 2);
+		bool echoed = true;
+		for (uint8_t expected : BAUDRATE_PATTERN)
+			echoed &= read() == expected;
+
+		if (echoed) {
+			if (!loseConfirm)
+				write(BAUDRATE_CONFIRM);
+			loseConfirm = false;
+
+			// The programmer falls back to the
+			// previous rate, if the confirmation
+			// is lost. Check the new rate by a
+			// round trip.
+			readFirmwareStatistics();
+			baudrate = newBaudrate;
+			return true;
+		}
+	} catch (ProgrammingError &) {
+		// The echo or the round trip timed out
+	}
+
+	// Wait for the programmer to fall back
+	// to the previous rate as well.
+	SimSerial::setHostBaudrate(baudrate);
+	SimHost::waitMicros(TRANSMITTER_BAUDRATE_TIMEOUT_MILLIS * 2 * 1000);
+	SimSerial::hostClear();
+
+	return false;
+}
+
+unsigned int Transmitter::begin(uint8_t mode)
+{
+	// The programmer responds with flags,
+	// its buffer sizes and its row size.
+	uint8_t command = 'b';
+	drainPipeline();
+	write(std::vector<uint8_t> { command, 0x00, mode });
+	checkCommand(command);
+
+	unsigned int flags = receiveBytes(2);
+	unsigned int writeBufferSize = receiveBytes(2);
+	unsigned int receiveBufferSize = receiveBytes(2);
+	unsigned int rowBytes = receiveBytes(2);
+	checkFeedback(command);
+
+	this->writeBufferSize = writeBufferSize;
+	this->receiveBufferSize = receiveBufferSize;
+	this->rowBytes = rowBytes;
+
+	return flags;
+}
+
+unsigned int Transmitter::getWriteBlockSize() const
+{
+	// Use whole rows, so every block is
+	// programmed in full row cycles.
+	if (rowBytes == 0 || rowBytes > writeBufferSize)
+		return writeBufferSize;
+	return writeBufferSize - writeBufferSize % rowBytes;
+}
+
+void Transmitter::beginReading()
+{
+	doCommand('n');
+}
+
+std::vector<uint8_t> Transmitter::readProgramWords(unsigned int numWords)
+{
+	std::vector<uint8_t> frame { 'R', (uint8_t)(numWords >> 8), (uint8_t)numWords };
+	drainPipeline();
+	write(frame);
+	checkCommand(frame[0]);
+
+	std::vector<uint8_t> data(numWords * 2);
+	waitForSerial(data.size());
+	for (uint8_t &byte : data)
+		byte = read();
+	uint8_t checksum = receiveBytes(1);
+
+	// Consume the status, before checking
+	// the checksum.
+	checkFeedback(frame[0]);
+
+	if (calculateChecksum(data.data(), data.size()) != checksum)
+		throw ProgrammingError("Invalid checksum of R command");
+
+	return data;
+}
+
+unsigned int Transmitter::checksumProgramWords(unsigned int numWords)
+{
+	return doReadWriteCommand('c', 2, numWords);
+}
+
+void Transmitter::endReading()
+{
+	doCommand('m');
+}
+
+void Transmitter::beginWriting()
+{
+	doCommand('j');
+}
+
+void Transmitter::writeBlock(const uint8_t *data, unsigned int numBytes)
+{
+	uint8_t command = 'w';
+	std::vector<uint8_t> encoded;
+	if (compressBlocks) {
+		encoded = encodeRunLength(data, numBytes);
+		if (encoded.size() < numBytes) {
+			command = 'z';
+			data = encoded.data();
+			numBytes = encoded.size();
+		}
+	}
+
+	// The block is framed by its length
+	// and a checksum byte.
+	std::vector<uint8_t> frame(numBytes + 4);
+	frame[0] = command;
+	frame[1] = numBytes >> 8;
+	frame[2] = numBytes;
+	std::copy(data, data + numBytes, frame.begin() + 3);
+	frame[numBytes + 3] = calculateChecksum(frame.data() + 1, numBytes + 2);
+
+	sendCommand(frame);
+}
+
+void Transmitter::endWriting()
+{
+	doCommand('k');
+}
+
+void Transmitter::setExtendedAddress(unsigned int extAddr)
+{
+	doWriteCommand('x', extAddr);
+}
+
+void Transmitter::setAddress(unsigned int addr)
+{
+	doWriteCommand('a', addr);
+}
+
+int Transmitter::readDeviceId()
+{
+	return doReadCommand('i', 2);
+}
+
+void Transmitter::eraseDevice()
+{
+	doCommand('e');
+}
+
+void Transmitter::eraseRow()
+{
+	doCommand('E');
+}
+
+void Transmitter::stop()
+{
+	doCommand('s');
+	drainPipeline();
+}
+
+std::vector<bool> Transmitter::readTargetResults(bool primaryVerified)
+{
+	uint8_t command = 'v';
+	drainPipeline();
+	write(command);
+	checkCommand(command);
+
+	unsigned int numTargets = receiveBytes(1);
+	unsigned int failedTargets = receiveBytes(1);
+	checkFeedback(command);
+
+	std::vector<bool> passed(numTargets);
+	for (unsigned int i = 0; i < numTargets; i++)
+		passed[i] = primaryVerified && (failedTargets & (1 << i)) == 0;
+
+	return passed;
+}
+
+std::vector<unsigned long> Transmitter::readFirmwareStatistics()
+{
+	uint8_t command = 'q';
+	drainPipeline();
+	write(command);
+	checkCommand(command);
+
+	std::vector<unsigned long> counters(TRANSMITTER_FIRMWARE_STATISTICS);
+	for (unsigned long &counter : counters)
+		counter = receiveBytes(4);
+	checkFeedback(command);
+
+	return counters;
+}
+
+void Transmitter::setPipelineWindow(unsigned int pipelineWindow)
+{
+	drainPipeline();
+
+	this->pipelineWindow = std::max(pipelineWindow, 1U);
+}
+
+void Transmitter::drainPipeline()
+{
+	while (!pendingCommands.empty())
+		receivePendingCommand();
+}
+
+void Transmitter::beginPhase(const std::string &name)
+{
+	phase.name = name;
+	phase.startCycles = SimClock::cycles;
+	phase.cycles = 0;
+	phase.bytesSent = 0;
+	phase.bytesReceived = 0;
+	phase.roundTrips = 0;
+	phase.clockEdges = SimPins::clockEdges;
+	phase.words = 0;
+	for (unsigned int i = 0; i < SIM_NUM_CATEGORIES; i++)
+		phase.categoryCycles[i] = SimClock::categoryCycles[i];
+}
+
+TransmitterPhase Transmitter::endPhase()
+{
+	// Include the commands still in flight
+	drainPipeline();
+
+	TransmitterPhase ended = phase;
+	ended.cycles = SimClock::cycles - phase.startCycles;
+	ended.clockEdges = SimPins::clockEdges - phase.clockEdges;
+	for (unsigned int i = 0; i < SIM_NUM_CATEGORIES; i++)
+		ended.categoryCycles[i] = SimClock::categoryCycles[i] - phase.categoryCycles[i];
+	return ended;
+}
+
+// ---------------------- COMMANDS ---------------------- //
+
+void Transmitter::doCommand(uint8_t command)
+{
+	sendCommand(std::vector<uint8_t> { command });
+}
+
+void Transmitter::doWriteCommand(uint8_t command, unsigned int data)
+{
+	sendCommand(std::vector<uint8_t> { command, (uint8_t)(data >> 8), (uint8_t)data });
+}
+
+unsigned int Transmitter::doReadCommand(uint8_t command, unsigned int numBytes)
+{
+	// The data is needed right away
+	drainPipeline();
+
+	write(command);
+	checkCommand(command);
+	unsigned int data = receiveBytes(numBytes);
+	checkFeedback(command);
+
+	return data;
+}
+
+unsigned int Transmitter::doReadWriteCommand(uint8_t command, unsigned int numBytes, unsigned int data)
+{
+	drainPipeline();
+
+	write(std::vector<uint8_t> { command, (uint8_t)(data >> 8), (uint8_t)data });
+	checkCommand(command);
+	unsigned int result = receiveBytes(numBytes);
+	checkFeedback(command);
+
+	return result;
+}
+
+void Transmitter::sendCommand(const std::vector<uint8_t> &frame)
+{
+	numCommands++;
+
+	// Without pipelining, the status of
+	// the command is checked right away.
+	if (pipelineWindow == 1) {
+		write(frame);
+		checkCommand(frame[0]);
+		checkFeedback(frame[0]);
+		return;
+	}
+
+	// Wait for the oldest commands, until
+	// the new command fits in the window.
+	while (!pendingCommands.empty() && (pendingCommands.size() >= pipelineWindow ||
+	       bytesInFlight + frame.size() > receiveBufferSize)) {
+		receivePendingCommand();
+	}
+
+	write(frame);
+	PendingCommand pending = { frame[0], (unsigned int)frame.size(), numCommands };
+	pendingCommands.push_back(pending);
+	bytesInFlight += frame.size();
+	maxBytesInFlight = std::max(maxBytesInFlight, bytesInFlight);
+}
+
+void Transmitter::receivePendingCommand()
+{
+	PendingCommand pending = pendingCommands.front();
+	pendingCommands.pop_front();
+	bytesInFlight -= pending.numBytes;
+
+	checkCommand(pending.command);
+
+	waitForSerial(1);
+	phase.roundTrips++;
+
+	uint8_t code = read();
+	if (code != COMMAND_SUCCESS_DATA) {
+		// Skip the responses of the following
+		// commands, to keep the serial in sync.
+		while (!pendingCommands.empty()) {
+			PendingCommand skipped = pendingCommands.front();
+			pendingCommands.pop_front();
+			checkCommand(skipped.command);
+			receiveBytes(1);
+		}
+		bytesInFlight = 0;
+
+		throw ProgrammingError(std::string("Failed ") + (char)pending.command + " command (command #" +
+		                       std::to_string(pending.index) + "), received code: " + (char)code);
+	}
+}
+
+std::vector<uint8_t> Transmitter::encodeRunLength(const uint8_t *data, unsigned int numBytes)
+{
+	// Same encoding as Programmer.encodeRunLength
+	std::vector<uint8_t> encoded;
+	auto encodeLiterals = [&encoded, data](unsigned int offset, unsigned int count) {
+		while (count > 0) {
+			unsigned int length = std::min(count, (unsigned int)TRANSMITTER_MAX_TOKEN_LENGTH);
+			encoded.push_back(length - 1);
+			encoded.insert(encoded.end(), data + offset, data + offset + length);
+			offset += length;
+			count -= length;
+		}
+	};
+
+	unsigned int literalStart = 0;
+	unsigned int i = 0;
+	while (i < numBytes) {
+		unsigned int run = 0;
+		if (i + 1 < numBytes) {
+			run = 1;
+			while (run < TRANSMITTER_MAX_TOKEN_LENGTH && i + (run + 1) * 2 <= numBytes &&
+			       data[i + run * 2 + 0] == data[i + 0] &&
+			       data[i + run * 2 + 1] == data[i + 1]) {
+				run++;
+			}
+		}
+
+		if (run < TRANSMITTER_MIN_RUN_LENGTH) {
+			i++;
+			continue;
+		}
+
+		encodeLiterals(literalStart, i - literalStart);
+		encoded.push_back(0x80 | (run - 1));
+		encoded.push_back(data[i + 0]);
+		encoded.push_back(data[i + 1]);
+
+		i += run * 2;
+		literalStart = i;
+	}
+	encodeLiterals(literalStart, numBytes - literalStart);
+
+	return encoded;
+}
+
+uint8_t Transmitter::calculateChecksum(const uint8_t *data, unsigned int numBytes)
+{
+	// Two's complement of the sum
+	uint8_t check = 0;
+	while (numBytes-- > 0)
+		check += *data++;
+	return (uint8_t)(~check + 1);
+}
+
+// ----------------------- SERIAL ----------------------- //
+
+unsigned int Transmitter::receiveBytes(unsigned int numBytes)
+{
+	waitForSerial(numBytes);
+
+	unsigned int data = 0;
+	while (numBytes-- != 0)
+		data = (data << 8) | read();
+	return data;
+}
+
+void Transmitter::checkFeedback(uint8_t command)
+{
+	waitForSerial(1);
+
+	// Every command ends with its status
+	phase.roundTrips++;
+
+	uint8_t code = read();
+	if (code != COMMAND_SUCCESS_DATA)
+		throw ProgrammingError(std::string("Failed ") + (char)command + " command, received code: " + (char)code);
+}
+
+void Transmitter::checkCommand(uint8_t command)
+{
+	while (true) {
+		waitForSerial(1);
+
+		if (read() == command)
+			break;
+	}
+}
+
+void Transmitter::waitForSerial(unsigned int numBytes, uint64_t timeoutMillis)
+{
+	if (!SimHost::waitForBytes(numBytes, timeoutMillis * 1000))
+		throw ProgrammingError("Timed out waiting for " + std::to_string(numBytes) + " bytes from programmer");
+}
+
+void Transmitter::write(uint8_t data)
+{
+	SimSerial::hostWrite(data);
+	phase.bytesSent++;
+}
+
+void Transmitter::write(const std::vector<uint8_t> &data)
+{
+	for (uint8_t byte : data)
+		SimSerial::hostWrite(byte);
+	phase.bytesSent += data.size();
+}
+
+uint8_t Transmitter::read()
+{
+	phase.bytesReceived++;
+	return SimSerial::hostRead();
+}
+
+// ------------------- HEX PROCESSORS ------------------- //
+
+void Transmitter::writeImage(const HexImage &hex, bool twoBytesPerAddress)
+{
+	beginWriting();
+	processImage(hex, twoBytesPerAddress, PROCESS_WRITE);
+	endWriting();
+}
+
+void Transmitter::verifyImage(const HexImage &hex, bool twoBytesPerAddress)
+{
+	beginReading();
+	processImage(hex, twoBytesPerAddress, PROCESS_VERIFY);
+	endReading();
+}
+
+bool Transmitter::writeChangedRows(const HexImage &hex, bool twoBytesPerAddress, unsigned int rowSize,
+                                   uint32_t configAddress)
+{
+	// Row erases only work on devices
+	// with two bytes per address.
+	if (rowSize == 0 || !twoBytesPerAddress) {
+		programEntireDevice(hex, twoBytesPerAddress);
+		return false;
+	}
+
+	// Collect the rows of the image
+	this->rowSize = rowSize;
+	rows.clear();
+	processImage(hex, twoBytesPerAddress, PROCESS_ROWS);
+
+	std::vector<uint32_t> changedRows;
+	unsigned int numProgramRows = 0;
+	bool configChanged = false;
+
+	beginReading();
+	for (const auto &row : rows) {
+		uint32_t rowAddress = row.first * rowSize;
+		if (rowAddress >= configAddress) {
+			// The configuration memory can't be
+			// row erased. Only compare the words
+			// in the image.
+			if (!matchesWords(rowAddress, row.second))
+				configChanged = true;
+		} else {
+			numProgramRows++;
+			if (!matchesChecksum(rowAddress, row.second))
+				changedRows.push_back(row.first);
+		}
+	}
+	endReading();
+
+	// If most rows changed, a bulk erase
+	// and a full rewrite is faster.
+	if (configChanged || changedRows.size() * 2 > numProgramRows) {
+		programEntireDevice(hex, twoBytesPerAddress);
+		return false;
+	}
+
+	beginWriting();
+	for (uint32_t rowIndex : changedRows) {
+		uint32_t rowAddress = rowIndex * rowSize;
+		setWordAddress(rowAddress);
+		eraseRow();
+
+		programRow(rowAddress, rows[rowIndex]);
+	}
+	endWriting();
+	return true;
+}
+
+void Transmitter::programEntireDevice(const HexImage &hex, bool twoBytesPerAddress)
+{
+	eraseDevice();
+	writeImage(hex, twoBytesPerAddress);
+}
+
+void Transmitter::storeRowWords(uint32_t address, const uint8_t *data, unsigned int numBytes)
+{
+	uint32_t byteAddress = (extendedAddress << 16) + address;
+	for (unsigned int i = 0; i < numBytes; i += 2) {
+		uint32_t wordAddress = (byteAddress + i) >> 1;
+
+		std::vector<int> &row = rows[wordAddress / rowSize];
+		if (row.empty())
+			row.assign(rowSize, -1);
+
+		row[wordAddress % rowSize] = getWord(data, i, numBytes) & TRANSMITTER_ERASED_WORD;
+	}
+}
+
+bool Transmitter::matchesChecksum(uint32_t rowAddress, const std::vector<int> &words)
+{
+	// Words not in the image will be erased,
+	// if the row is reprogrammed.
+	unsigned int crc = 0xFFFF;
+	for (int word : words) {
+		if (word == -1)
+			word = TRANSMITTER_ERASED_WORD;
+		crc = crc16(crc, word >> 8);
+		crc = crc16(crc, word);
+	}
+
+	setWordAddress(rowAddress);
+	return checksumProgramWords(words.size()) == crc;
+}
+
+bool Transmitter::matchesWords(uint32_t rowAddress, const std::vector<int> &words)
+{
+	unsigned int i = 0;
+	while (i < words.size()) {
+		// Find the next run of words
+		if (words[i] == -1) {
+			i++;
+			continue;
+		}
+		unsigned int runStart = i;
+		while (i < words.size() && words[i] != -1)
+			i++;
+
+		setWordAddress(rowAddress + runStart);
+		std::vector<uint8_t> programmedWords = readProgramWords(i - runStart);
+		for (unsigned int j = runStart; j < i; j++) {
+			unsigned int index = (j - runStart) * 2;
+			int programmedWord = (programmedWords[index] << 8) | programmedWords[index + 1];
+			if (programmedWord != words[j])
+				return false;
+		}
+	}
+	return true;
+}
+
+void Transmitter::programRow(uint32_t rowAddress, const std::vector<int> &words)
+{
+	unsigned int i = 0;
+	while (i < words.size()) {
+		// Find the next run of words
+		if (words[i] == -1) {
+			i++;
+			continue;
+		}
+		unsigned int runStart = i;
+		while (i < words.size() && words[i] != -1)
+			i++;
+
+		// Words are programmed little endian
+		std::vector<uint8_t> data;
+		for (unsigned int j = runStart; j < i; j++) {
+			data.push_back(words[j]);
+			data.push_back(words[j] >> 8);
+		}
+		phase.words += i - runStart;
+
+		setWordAddress(rowAddress + runStart);
+		unsigned int maxBlockSize = getWriteBlockSize();
+		for (unsigned int j = 0; j < data.size(); j += maxBlockSize) {
+			unsigned int blockSize = std::min((unsigned int)data.size() - j, maxBlockSize);
+			writeBlock(data.data() + j, blockSize);
+		}
+	}
+}
+
+void Transmitter::setWordAddress(uint32_t address)
+{
+	// The programmer adds 8000h words
+	// per extended address.
+	setExtendedAddress(address >> 15);
+	setAddress(address & 0x7FFF);
+}
+
+void Transmitter::processImage(const HexImage &hex, bool twoBytesPerAddress, ProcessMode mode)
+{
+	// Spans are sorted by address, and don't
+	// cross the range of an extended address.
+	long lastExtendedAddress = -1;
+	for (const HexSpan &span : hex.getSpans()) {
+		if ((long)(span.address >> 16) != lastExtendedAddress) {
+			lastExtendedAddress = span.address >> 16;
+			extendedAddress = lastExtendedAddress;
+			if (mode != PROCESS_ROWS)
+				setExtendedAddress(extendedAddress);
+		}
+
+		// Data memory is written a byte at a
+		// time. Every byte is programmed.
+		if (dataAddress != -1 && span.address >= (unsigned long)dataAddress) {
+			programData(span.address & 0xFFFF, span.data.data(), span.data.size(), twoBytesPerAddress, mode);
+		} else {
+			processData(span.address & 0xFFFF, span.data.data(), span.data.size(), twoBytesPerAddress, mode);
+		}
+	}
+}
+
+void Transmitter::processData(uint32_t address, const uint8_t *data, unsigned int numBytes,
+                              bool twoBytesPerAddress, ProcessMode mode)
+{
+	// Runs of erased words are skipped, if
+	// they are at the start or the end of a
+	// part, or long enough to seek past.
+	auto isErasedWord = [data, numBytes, twoBytesPerAddress](unsigned int offset) {
+		unsigned int word = getWord(data, offset, numBytes);
+		if (twoBytesPerAddress)
+			return (word & 0x3FFF) == 0x3FFF;
+		return word == 0xFFFF;
+	};
+
+	unsigned int offset = 0;
+	unsigned int i = 0;
+	while (i < numBytes) {
+		if (!isErasedWord(i)) {
+			i += 2;
+			continue;
+		}
+
+		unsigned int runEnd = i;
+		while (runEnd < numBytes && isErasedWord(runEnd))
+			runEnd += 2;
+		runEnd = std::min(runEnd, numBytes);
+
+		if (i == offset || runEnd == numBytes || runEnd - i >= TRANSMITTER_MIN_ERASED_RUN) {
+			if (i > offset)
+				programData(address + offset, data + offset, i - offset, twoBytesPerAddress, mode);
+			offset = runEnd;
+		}
+
+		i = runEnd;
+	}
+
+	if (offset < numBytes)
+		programData(address + offset, data + offset, numBytes - offset, twoBytesPerAddress, mode);
+}
+
+void Transmitter::programData(uint32_t address, const uint8_t *data, unsigned int numBytes,
+                              bool twoBytesPerAddress, ProcessMode mode)
+{
+	if (mode == PROCESS_ROWS) {
+		storeRowWords(address, data, numBytes);
+		return;
+	}
+
+	phase.words += twoBytesPerAddress ? (numBytes + 1) / 2 : numBytes;
+
+	if (twoBytesPerAddress)
+		address >>= 1;
+
+	if (mode == PROCESS_VERIFY) {
+		// Long spans are verified in chunks
+		unsigned int i = 0;
+		while (i < numBytes) {
+			unsigned int chunkSize = std::min(numBytes - i, (unsigned int)TRANSMITTER_MAX_VERIFY_BYTES);
+			verifyData(address + (twoBytesPerAddress ? i / 2 : i), data + i, chunkSize, twoBytesPerAddress);
+			i += chunkSize;
+		}
+		return;
+	}
+	setAddress(address);
+
+	// Blocks are aligned to the block size, so
+	// they don't split rows of the device.
+	uint32_t byteAddress = twoBytesPerAddress ? (address << 1) : address;
+	unsigned int maxBlockSize = getWriteBlockSize();
+	unsigned int i = 0;
+	while (i < numBytes) {
+		uint32_t blockEnd = ((byteAddress + i) / maxBlockSize + 1) * maxBlockSize;
+		unsigned int blockSize = std::min(numBytes - i, blockEnd - (byteAddress + i));
+		writeBlock(data + i, blockSize);
+		i += blockSize;
+	}
+}
+
+void Transmitter::verifyData(uint32_t address, const uint8_t *data, unsigned int numBytes, bool twoBytesPerAddress)
+{
+	setAddress(address);
+
+	// Checksum the hex words, as they are read
+	// from the programmer, MSB first.
+	unsigned int increment = twoBytesPerAddress ? 2 : 1;
+	unsigned int numWords = twoBytesPerAddress ? (numBytes + 1) / 2 : numBytes;
+
+	unsigned int crc = 0xFFFF;
+	for (unsigned int i = 0; i < numBytes; i += increment) {
+		unsigned int hexWord = twoBytesPerAddress ? getWord(data, i, numBytes) : data[i];
+		crc = crc16(crc, hexWord >> 8);
+		crc = crc16(crc, hexWord);
+	}
+	if (checksumProgramWords(numWords) == crc)
+		return;
+
+	// Read back the entire span to find the
+	// mismatching word.
+	setAddress(address);
+	std::vector<uint8_t> programmedWords = readProgramWords(numWords);
+
+	for (unsigned int i = 0; i < numBytes; i += increment) {
+		unsigned int index = (i / increment) * 2;
+		unsigned int programmedWord = (programmedWords[index] << 8) | programmedWords[index + 1];
+		unsigned int hexWord = twoBytesPerAddress ? getWord(data, i, numBytes) : data[i];
+		if (!twoBytesPerAddress)
+			programmedWord &= 0xFF;
+
+		if (programmedWord != hexWord)
+			throw ProgrammingError("Program data: " + hex(programmedWord) + " at address " +
+			                       hex(address + (twoBytesPerAddress ? i / 2 : i)) + " does not match hex: " + hex(hexWord));
+	}
+
+	throw ProgrammingError("Program checksum at address " + hex(address) + " does not match hex");
+}
@@ -0,0 +1,193 @@
+/*
+ * Port of the transmitter (src/processing_code) to the
+ * host build. Programmer.java and the hex processors
+ * are followed closely, so the simulated session sends
+ * the same commands, blocks and pipeline as the real
+ * one. Serial timeouts are in modelled time.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "./hex_image.h"
+#include "./sim_clock.h"
+
+// Same as Programmer.java
+#define TRANSMITTER_DEFAULT_WRITE_BUFFER_SIZE 32
+#define TRANSMITTER_DEFAULT_BYTES_IN_FLIGHT   64
+#define TRANSMITTER_RECEIVE_TIMEOUT_MILLIS    5000
+#define TRANSMITTER_BAUDRATE_TIMEOUT_MILLIS   200
+#define TRANSMITTER_MAX_TOKEN_LENGTH          128
+#define TRANSMITTER_MIN_RUN_LENGTH            3
+#define TRANSMITTER_MIN_ERASED_RUN            16
+#define TRANSMITTER_MAX_VERIFY_BYTES          2048
+#define TRANSMITTER_FIRMWARE_STATISTICS       10
+
+// Same as HexDiffProcessor.java
+#define TRANSMITTER_ERASED_WORD 0x3FFF
+
+class ProgrammingError : public std::runtime_error
+{
+
+public:
+	explicit ProgrammingError(const std::string &message)
+		: std::runtime_error(message) { }
+};
+
+// Transfer statistics of a phase
+struct TransmitterPhase
+{
+	std::string name;
+	uint64_t startCycles;
+	uint64_t cycles;
+	uint64_t bytesSent;
+	uint64_t bytesReceived;
+	uint64_t roundTrips;
+	// Rising edges of ICSPCLK and the words
+	// of the image processed.
+	uint64_t clockEdges;
+	uint64_t words;
+	// Modelled cycles by what they were spent on
+	uint64_t categoryCycles[SIM_NUM_CATEGORIES];
+};
+
+// ------------------- TRANSMITTER -------------------- //
+
+class Transmitter
+{
+
+public:
+	explicit Transmitter(unsigned long baudrate);
+
+	void waitForPowerGood();
+	unsigned long negotiateBaudrate();
+
+	unsigned int begin(uint8_t mode);
+	unsigned int getWriteBlockSize() const;
+	unsigned int getReceiveBufferSize() const { return receiveBufferSize; }
+
+	void beginReading();
+	std::vector<uint8_t> readProgramWords(unsigned int numWords);
+	unsigned int checksumProgramWords(unsigned int numWords);
+	void endReading();
+
+	void beginWriting();
+	void writeBlock(const uint8_t *data, unsigned int numBytes);
+	void endWriting();
+
+	void setExtendedAddress(unsigned int extAddr);
+	void setAddress(unsigned int addr);
+
+	int readDeviceId();
+	void eraseDevice();
+	void eraseRow();
+	void stop();
+
+	// Pass/fail of every target. The primary
+	// target (0) is given by its verification,
+	// the gang targets are compared to it.
+	std::vector<bool> readTargetResults(bool primaryVerified);
+	std::vector<unsigned long> readFirmwareStatistics();
+
+	void setCompressBlocks(bool compressBlocks) { this->compressBlocks = compressBlocks; }
+	// Leaves out the next baudrate confirmation,
+	// as if it was lost on the line.
+	void loseBaudrateConfirm() { loseConfirm = true; }
+	void setDataAddress(long dataAddress) { this->dataAddress = dataAddress; }
+	void setPipelineWindow(unsigned int pipelineWindow);
+	void drainPipeline();
+
+	void beginPhase(const std::string &name);
+	TransmitterPhase endPhase();
+	// The largest number of bytes in flight
+	unsigned int getMaxBytesInFlight() const { return maxBytesInFlight; }
+
+	// HexWriteProcessor and HexReadProcessor
+	void writeImage(const HexImage &hex, bool twoBytesPerAddress);
+	void verifyImage(const HexImage &hex, bool twoBytesPerAddress);
+	// HexDiffProcessor, returns false if the
+	// entire device was programmed instead.
+	bool writeChangedRows(const HexImage &hex, bool twoBytesPerAddress, unsigned int rowSize, uint32_t configAddress);
+
+	static std::vector<uint8_t> encodeRunLength(const uint8_t *data, unsigned int numBytes);
+	static uint8_t calculateChecksum(const uint8_t *data, unsigned int numBytes);
+
+private:
+	struct PendingCommand
+	{
+		uint8_t command;
+		unsigned int numBytes;
+		uint64_t index;
+	};
+
+	bool tryBaudrate(unsigned long newBaudrate);
+
+	void doCommand(uint8_t command);
+	void doWriteCommand(uint8_t command, unsigned int data);
+	unsigned int doReadCommand(uint8_t command, unsigned int numBytes);
+	unsigned int doReadWriteCommand(uint8_t command, unsigned int numBytes, unsigned int data);
+	void sendCommand(const std::vector<uint8_t> &frame);
+	void receivePendingCommand();
+
+	unsigned int receiveBytes(unsigned int numBytes);
+	void checkFeedback(uint8_t command);
+	void checkCommand(uint8_t command);
+	void waitForSerial(unsigned int numBytes, uint64_t timeoutMillis = TRANSMITTER_RECEIVE_TIMEOUT_MILLIS);
+
+	void write(uint8_t data);
+	void write(const std::vector<uint8_t> &data);
+	uint8_t read();
+
+	// What the processed data is used for
+	enum ProcessMode
+	{
+		PROCESS_WRITE,
+		PROCESS_VERIFY,
+		// Stored by row for HexDiffProcessor
+		PROCESS_ROWS
+	};
+
+	// HexProcessor
+	void processImage(const HexImage &hex, bool twoBytesPerAddress, ProcessMode mode);
+	void processData(uint32_t address, const uint8_t *data, unsigned int numBytes, bool twoBytesPerAddress, ProcessMode mode);
+	void programData(uint32_t address, const uint8_t *data, unsigned int numBytes, bool twoBytesPerAddress, ProcessMode mode);
+	void verifyData(uint32_t address, const uint8_t *data, unsigned int numBytes, bool twoBytesPerAddress);
+
+	// HexDiffProcessor
+	void programEntireDevice(const HexImage &hex, bool twoBytesPerAddress);
+	void storeRowWords(uint32_t address, const uint8_t *data, unsigned int numBytes);
+	bool matchesChecksum(uint32_t rowAddress, const std::vector<int> &words);
+	bool matchesWords(uint32_t rowAddress, const std::vector<int> &words);
+	void programRow(uint32_t rowAddress, const std::vector<int> &words);
+	void setWordAddress(uint32_t address);
+
+	unsigned long baudrate;
+	bool compressBlocks;
+	bool loseConfirm;
+
+	unsigned int writeBufferSize;
+	unsigned int receiveBufferSize;
+	unsigned int rowBytes;
+	long dataAddress;
+
+	unsigned int pipelineWindow;
+	std::deque<PendingCommand> pendingCommands;
+	unsigned int bytesInFlight;
+	unsigned int maxBytesInFlight;
+	uint64_t numCommands;
+
+	TransmitterPhase phase;
+
+	// The words of the image by row, -1 where
+	// the image has no data.
+	std::map<uint32_t, std::vector<int>> rows;
+	unsigned int rowSize;
+	uint32_t extendedAddress;
+};